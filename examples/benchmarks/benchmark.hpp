@@ -0,0 +1,95 @@
+// File: examples/benchmarks/benchmark.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <cstdint>
+#include <cstdio>
+
+/*
+The benchmarks that do not touch the hardware also build for the host,
+see host/CMakeLists.txt, which defines BENCHMARK_HOST. There they time
+with std::chrono, report nanoseconds instead of cycles and run once.
+
+Inputs and anything large are static, the core0 stack is only 2 KB.
+*/
+#if BENCHMARK_HOST
+#include <chrono>
+
+#define bi_decl(declaration)
+inline void stdio_init_all() {}
+#else
+#include "pico/stdlib.h"
+#include "pico/binary_info.h"
+#include "hardware/clocks.h"
+#endif
+
+// how often each benchmark reprints its results
+constexpr uint32_t BENCHMARK_PERIOD_MS{5000};
+
+#if BENCHMARK_HOST
+constexpr const char* BENCHMARK_UNIT{"ns"};
+#else
+constexpr const char* BENCHMARK_UNIT{"cycles"};
+#endif
+
+// xorshift32, repeatable input without the C library's rand()
+inline uint32_t next_random(uint32_t &state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+// Makes the compiler treat value as used so the work producing it stays.
+template<typename T>
+inline void keep_result(const T &value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Average system clock cycles per call of f, nanoseconds on the host. The
+// Pico's timer ticks once a microsecond, iterations should cover a few
+// milliseconds.
+template<typename F>
+uint32_t measure_cycles(uint32_t iterations, F&& f) {
+#if BENCHMARK_HOST
+	const auto start{std::chrono::steady_clock::now()};
+	for (uint32_t i = 0; i < iterations; i++) {
+		f();
+	}
+	const auto elapsed{std::chrono::steady_clock::now() - start};
+	const auto elapsed_ns{std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()};
+	return static_cast<uint32_t>(static_cast<uint64_t>(elapsed_ns) / iterations);
+#else
+	const uint32_t start_us{time_us_32()};
+	for (uint32_t i = 0; i < iterations; i++) {
+		f();
+	}
+	const uint32_t elapsed_us{time_us_32() - start_us};
+	const uint64_t cycles{static_cast<uint64_t>(elapsed_us) * (clock_get_hz(clk_sys) / 1000000U)};
+	return static_cast<uint32_t>(cycles / iterations);
+#endif
+}
+
+// Waits out the period before the next run, the host runs once.
+inline bool wait_for_next_run() {
+#if BENCHMARK_HOST
+	return false;
+#else
+	sleep_ms(BENCHMARK_PERIOD_MS);
+	return true;
+#endif
+}
+
+// One line per comparison, the speedup is printed without float formatting.
+inline void print_comparison(const char* name, uint32_t old_cycles, uint32_t new_cycles) {
+	const uint64_t speedup_percent{new_cycles == 0 ? 0 : static_cast<uint64_t>(old_cycles) * 100U / new_cycles};
+	printf("%-28s old %7lu new %7lu %-6s %3lu.%02lux\n",
+		name, static_cast<unsigned long>(old_cycles), static_cast<unsigned long>(new_cycles), BENCHMARK_UNIT,
+		static_cast<unsigned long>(speedup_percent / 100U), static_cast<unsigned long>(speedup_percent % 100U));
+}
+
+#endif
@@ -0,0 +1,141 @@
+// File: examples/benchmarks/filter_benchmark.cpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+/*
+Times the float filters against their fixed point versions on the M0+,
+which has no FPU, with the same accelerometer and gyro input.
+	accel angles: std::atan2 and std::sqrt against atan2_q16_degrees and
+	              isqrt32, the largest difference is printed in millidegrees
+	complementary: ComplementaryFilter against FixedPointComplementaryFilter,
+	               the float filter also publishes its seqlock snapshot
+	mahony: MahonyFilter<float> against FixedPointMahonyFilter, the angles
+	        the two end up at after the run are printed side by side
+*/
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+#include "complementary_filter.hpp"
+#include "fixed_point.hpp"
+#include "mahony_filter.hpp"
+
+#include "benchmark.hpp"
+
+constexpr size_t SAMPLE_COUNT{256};
+constexpr uint32_t ITERATIONS{20};
+constexpr float DT{1.0F / 100.0F};
+
+struct Input {
+	std::array<int16_t, 3> accel;
+	std::array<float, 3> gyro;
+	std::array<int32_t, 3> gyro_q16;
+};
+
+static std::array<Input, SAMPLE_COUNT> inputs{};
+
+static void run_accel_angles() {
+	int32_t max_error_q16{0};
+	for (const auto& input : inputs) {
+		const auto [pitch, roll] = accelerometer_angles(input.accel);
+		const int32_t x{input.accel[0]};
+		const int32_t y{input.accel[1]};
+		const int32_t z{input.accel[2]};
+		const int32_t pitch_q16{atan2_q16_degrees(x, static_cast<int32_t>(isqrt32(static_cast<uint32_t>(y*y + z*z))))};
+		const int32_t roll_q16{atan2_q16_degrees(y, static_cast<int32_t>(isqrt32(static_cast<uint32_t>(x*x + z*z))))};
+		max_error_q16 = std::max(max_error_q16, std::abs(pitch_q16 - float_to_q16(pitch)));
+		max_error_q16 = std::max(max_error_q16, std::abs(roll_q16 - float_to_q16(roll)));
+	}
+
+	const uint32_t float_cycles{measure_cycles(ITERATIONS, []() {
+		for (const auto& input : inputs) {
+			keep_result(accelerometer_angles(input.accel));
+		}
+	})};
+	const uint32_t fixed_cycles{measure_cycles(ITERATIONS, []() {
+		for (const auto& input : inputs) {
+			const int32_t x{input.accel[0]};
+			const int32_t y{input.accel[1]};
+			const int32_t z{input.accel[2]};
+			keep_result(atan2_q16_degrees(x, static_cast<int32_t>(isqrt32(static_cast<uint32_t>(y*y + z*z)))));
+			keep_result(atan2_q16_degrees(y, static_cast<int32_t>(isqrt32(static_cast<uint32_t>(x*x + z*z)))));
+		}
+	})};
+	print_comparison("accel angles per sample", float_cycles / SAMPLE_COUNT, fixed_cycles / SAMPLE_COUNT);
+	printf("  largest difference %ld millidegrees\n",
+		static_cast<long>((static_cast<int64_t>(max_error_q16) * 1000) >> 16));
+}
+
+static void run_complementary() {
+	static ComplementaryFilter float_filter(DT, DEFAULT_GYRO_BIAS);
+	static FixedPointComplementaryFilter fixed_filter(DT, DEFAULT_GYRO_BIAS);
+
+	const uint32_t float_cycles{measure_cycles(ITERATIONS, []() {
+		for (const auto& input : inputs) {
+			float_filter.update(input.accel, input.gyro);
+		}
+		keep_result(float_filter.get_filtered_angles());
+	})};
+	const uint32_t fixed_cycles{measure_cycles(ITERATIONS, []() {
+		for (const auto& input : inputs) {
+			fixed_filter.update(input.accel, input.gyro_q16);
+		}
+		keep_result(fixed_filter.get_filtered_angles_q16());
+	})};
+	print_comparison("complementary per update", float_cycles / SAMPLE_COUNT, fixed_cycles / SAMPLE_COUNT);
+}
+
+static void run_mahony() {
+	static MahonyFilter<float> float_filter(DT);
+	static FixedPointMahonyFilter fixed_filter(DT);
+
+	const uint32_t float_cycles{measure_cycles(ITERATIONS, []() {
+		for (const auto& input : inputs) {
+			float_filter.update(input.accel, input.gyro);
+		}
+		keep_result(float_filter.get_quaternion());
+	})};
+	const uint32_t fixed_cycles{measure_cycles(ITERATIONS, []() {
+		for (const auto& input : inputs) {
+			fixed_filter.update(input.accel, input.gyro_q16);
+		}
+		keep_result(fixed_filter.get_quaternion());
+	})};
+	print_comparison("mahony per update", float_cycles / SAMPLE_COUNT, fixed_cycles / SAMPLE_COUNT);
+
+	// printed in millidegrees, printf's float code is left out
+	const EulerAngles float_angles{float_filter.get_euler_angles()};
+	const EulerAngles fixed_angles{fixed_filter.get_euler_angles()};
+	printf("  pitch %ld/%ld roll %ld/%ld millidegrees\n",
+		static_cast<long>(float_angles.pitch * 1000.0F), static_cast<long>(fixed_angles.pitch * 1000.0F),
+		static_cast<long>(float_angles.roll * 1000.0F), static_cast<long>(fixed_angles.roll * 1000.0F));
+}
+
+int main() {
+	stdio_init_all();
+	printf("Starting up filter benchmark.\n");
+
+	bi_decl(bi_program_name("filter_benchmark"));
+	bi_decl(bi_program_description("Times the float orientation filters against their fixed point versions."));
+	bi_decl(bi_program_version_string("1.0.0"));
+	bi_decl(bi_program_url("https://github.com/jacobguenther/pico-libs"));
+	bi_decl(bi_program_feature("License AGPLv3"));
+
+	// a board tilted every which way at 2048 LSB/g with some noise
+	uint32_t random{0x12345678};
+	for (auto& input : inputs) {
+		for (size_t axis = 0; axis < 3; axis++) {
+			input.accel[axis] = static_cast<int16_t>(static_cast<int32_t>(next_random(random) % 4096) - 2048);
+			input.gyro[axis] = static_cast<float>(static_cast<int32_t>(next_random(random) % 2001) - 1000) / 10.0F;
+			input.gyro_q16[axis] = float_to_q16(input.gyro[axis]);
+		}
+	}
+
+	do {
+		run_accel_angles();
+		run_complementary();
+		run_mahony();
+	} while (wait_for_next_run());
+}
@@ -0,0 +1,110 @@
+// File: examples/benchmarks/key_bitmap_benchmark.cpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+/*
+Times finding the changed keys between two scans for several matrix sizes.
+	old: every key's bit tested in the previous and current scan, the way
+	     poll_buttons() compared one key at a time
+	new: for_each_changed_key(), one xor per word and ctz over the set bits
+Each scan changes 0 to 2 keys like real typing. The events of both are
+folded into a hash and compared.
+*/
+
+#include <array>
+
+#include "pico/stdlib.h"
+#include "pico/binary_info.h"
+
+#include "key_bitmap.hpp"
+
+#include "benchmark.hpp"
+
+constexpr size_t SCAN_COUNT{1024};
+
+// the per key comparison for_each_changed_key() replaced
+template<size_t key_count, size_t word_count, typename F>
+static void for_each_changed_key_per_bit(
+	const std::array<uint32_t, word_count> &previous,
+	const std::array<uint32_t, word_count> &current,
+	F&& f)
+{
+	for (size_t key = 0; key < key_count; key++) {
+		const size_t word{key / KEY_BITMAP_WORD_BITS};
+		const uint32_t mask{1U << (key % KEY_BITMAP_WORD_BITS)};
+		const bool was_down{(previous[word] & mask) != 0U};
+		const bool is_down{(current[word] & mask) != 0U};
+		if (was_down != is_down) {
+			f(static_cast<uint8_t>(key), is_down);
+		}
+	}
+}
+
+static uint32_t hash_event(uint32_t hash, uint8_t key_index, bool is_down) {
+	return hash * 31U + (static_cast<uint32_t>(key_index) << 1 | static_cast<uint32_t>(is_down));
+}
+
+template<size_t key_count>
+static void run_keys() {
+	constexpr size_t WORD_COUNT{key_bitmap_words(key_count)};
+	using Bitmap = std::array<uint32_t, WORD_COUNT>;
+	static std::array<Bitmap, SCAN_COUNT> scans{};
+
+	uint32_t random{0x12345678};
+	Bitmap bitmap{};
+	for (Bitmap& scan : scans) {
+		const uint32_t changes{next_random(random) % 3};
+		for (uint32_t i = 0; i < changes; i++) {
+			const size_t key{next_random(random) % key_count};
+			bitmap[key / KEY_BITMAP_WORD_BITS] ^= 1U << (key % KEY_BITMAP_WORD_BITS);
+		}
+		scan = bitmap;
+	}
+
+	uint32_t per_bit_hash{0};
+	uint32_t changed_hash{0};
+	// one pass over every scan per call
+	const uint32_t per_bit_cycles{measure_cycles(1, [&]() {
+		per_bit_hash = 0;
+		for (size_t i = 1; i < SCAN_COUNT; i++) {
+			for_each_changed_key_per_bit<key_count>(scans[i - 1], scans[i], [&](uint8_t key_index, bool is_down) {
+				per_bit_hash = hash_event(per_bit_hash, key_index, is_down);
+			});
+		}
+		keep_result(per_bit_hash);
+	})};
+	const uint32_t changed_cycles{measure_cycles(1, [&]() {
+		changed_hash = 0;
+		for (size_t i = 1; i < SCAN_COUNT; i++) {
+			for_each_changed_key(scans[i - 1], scans[i], [&](uint8_t key_index, bool is_down) {
+				changed_hash = hash_event(changed_hash, key_index, is_down);
+			});
+		}
+		keep_result(changed_hash);
+	})};
+
+	char name[32];
+	snprintf(name, sizeof(name), "%3u keys per scan", static_cast<unsigned>(key_count));
+	print_comparison(name, per_bit_cycles / (SCAN_COUNT - 1), changed_cycles / (SCAN_COUNT - 1));
+	if (per_bit_hash != changed_hash) {
+		printf("  key events DIFFER\n");
+	}
+}
+
+int main() {
+	stdio_init_all();
+	printf("Starting up key bitmap benchmark.\n");
+
+	bi_decl(bi_program_name("key_bitmap_benchmark"));
+	bi_decl(bi_program_description("Times the ctz changed key scan against testing every key."));
+	bi_decl(bi_program_version_string("1.0.0"));
+	bi_decl(bi_program_url("https://github.com/jacobguenther/pico-libs"));
+	bi_decl(bi_program_feature("License AGPLv3"));
+
+	do {
+		run_keys<9>();
+		run_keys<64>();
+		run_keys<128>();
+	} while (wait_for_next_run());
+}
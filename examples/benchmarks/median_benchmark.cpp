@@ -0,0 +1,123 @@
+// File: examples/benchmarks/median_benchmark.cpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+/*
+Times one update() and get_median() per sample for several window sizes.
+	old: the queue_t window copied out and partially sorted with
+	     nth_element on every get_median()
+	new: MedianFilter's two heaps, O(log n) update and O(1) median
+Every median of both filters is compared once the window is full.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "pico/stdlib.h"
+#include "pico/binary_info.h"
+#include "pico/util/queue.h"
+
+#include "median_filter.hpp"
+
+#include "benchmark.hpp"
+
+constexpr uint32_t SAMPLE_COUNT{4096};
+
+// the filter MedianFilter replaced
+template<size_t sz>
+class SortMedianFilter {
+public:
+	using element_t = int16_t;
+	SortMedianFilter() {
+		queue_init(&_window, sizeof(element_t), sz);
+	}
+	~SortMedianFilter() {
+		queue_free(&_window);
+	}
+
+	SortMedianFilter(const SortMedianFilter&)=delete;
+	SortMedianFilter(const SortMedianFilter&&)=delete;
+	SortMedianFilter& operator=(const SortMedianFilter&)=delete;
+	SortMedianFilter& operator=(const SortMedianFilter&&)=delete;
+
+	void update(element_t value) {
+		if (queue_is_full(&_window)) {
+			queue_try_remove(&_window, nullptr);
+		}
+		queue_try_add(&_window, &value);
+	}
+	element_t get_median() {
+		const uint32_t size{queue_get_level(&_window)};
+		memcpy(&_data, _window.data, sizeof(element_t) * sz);
+		const uint32_t middle{size / 2};
+		std::nth_element(_data.begin(), _data.begin() + middle, _data.begin() + size);
+		return _data[middle];
+	}
+private:
+	queue_t _window;
+	std::array<element_t, sz> _data{};
+};
+
+// noisy accelerometer like input
+static std::array<int16_t, SAMPLE_COUNT> samples{};
+
+template<size_t sz>
+static void run_window() {
+	static SortMedianFilter<sz> sort_filter;
+	static MedianFilter<sz> heap_filter;
+
+	uint32_t mismatches{0};
+	for (size_t i = 0; i < SAMPLE_COUNT; i++) {
+		sort_filter.update(samples[i]);
+		heap_filter.update(samples[i]);
+		if (i + 1 >= sz && sort_filter.get_median() != heap_filter.get_median()) {
+			mismatches++;
+		}
+	}
+
+	// one pass over every sample per call
+	const uint32_t sort_cycles{measure_cycles(1, [&]() {
+		for (const int16_t sample : samples) {
+			sort_filter.update(sample);
+			keep_result(sort_filter.get_median());
+		}
+	})};
+	const uint32_t heap_cycles{measure_cycles(1, [&]() {
+		for (const int16_t sample : samples) {
+			heap_filter.update(sample);
+			keep_result(heap_filter.get_median());
+		}
+	})};
+
+	char name[32];
+	snprintf(name, sizeof(name), "window %3u per sample", static_cast<unsigned>(sz));
+	print_comparison(name, sort_cycles / SAMPLE_COUNT, heap_cycles / SAMPLE_COUNT);
+	if (mismatches != 0) {
+		printf("  %lu medians DIFFER\n", mismatches);
+	}
+}
+
+int main() {
+	stdio_init_all();
+	printf("Starting up median filter benchmark.\n");
+
+	bi_decl(bi_program_name("median_benchmark"));
+	bi_decl(bi_program_description("Times the heap MedianFilter against the sort based filter it replaced."));
+	bi_decl(bi_program_version_string("1.0.0"));
+	bi_decl(bi_program_url("https://github.com/jacobguenther/pico-libs"));
+	bi_decl(bi_program_feature("License AGPLv3"));
+
+	uint32_t random{0x12345678};
+	for (auto& sample : samples) {
+		sample = static_cast<int16_t>(2048 + static_cast<int32_t>(next_random(random) % 512) - 256);
+	}
+
+	do {
+		run_window<3>();
+		run_window<9>();
+		run_window<31>();
+		run_window<101>();
+	} while (wait_for_next_run());
+}
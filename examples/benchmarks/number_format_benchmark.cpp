@@ -0,0 +1,130 @@
+// File: examples/benchmarks/number_format_benchmark.cpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+/*
+Checks format_decimal() against snprintf("%.*f") and times both.
+
+Built against the C library's printf, see CMakeLists.txt, which rounds the
+exact binary value half to even just like format_decimal(). printf keeps
+the sign of values that round to zero ("-0.00"), format_decimal() drops
+it, those are compared without the sign.
+
+Every precision from 0 to MAX_FORMAT_DECIMALS is checked against random
+bit patterns below 2^32 and against exact halves and quarters, where the
+rounding direction matters.
+*/
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+#include "pico/stdlib.h"
+#include "pico/binary_info.h"
+
+#include "number_format.hpp"
+
+#include "benchmark.hpp"
+
+constexpr size_t VALUE_COUNT{256};
+constexpr uint32_t RANDOM_CHECKS{20000};
+constexpr uint32_t ITERATIONS{10};
+constexpr size_t TEXT_SIZE{32};
+
+static std::array<float, VALUE_COUNT> values{};
+
+// Pitch and roll like values, degrees with a few decimals.
+static float random_angle(uint32_t &state) {
+	return static_cast<float>(static_cast<int32_t>(next_random(state) % 36001) - 18000) / 100.0F;
+}
+// Any finite float format_decimal() accepts.
+static float random_float(uint32_t &state) {
+	while (true) {
+		const uint32_t bits{next_random(state)};
+		float value{0.0F};
+		std::memcpy(&value, &bits, sizeof(value));
+		if (value > -4294967296.0F && value < 4294967296.0F) {
+			return value;
+		}
+	}
+}
+
+static bool same_text(float value, uint8_t decimals) {
+	std::array<char, TEXT_SIZE> expected{};
+	std::array<char, TEXT_SIZE> formatted{};
+	snprintf(expected.data(), expected.size(), "%.*f", static_cast<int>(decimals), static_cast<double>(value));
+	format_decimal(formatted.data(), formatted.size(), value, decimals);
+
+	const char* compared{expected.data()};
+	if (expected[0] == '-' && std::strpbrk(expected.data(), "123456789") == nullptr) {
+		compared++;
+	}
+	if (std::strcmp(compared, formatted.data()) != 0) {
+		printf("  %.9g with %u decimals: printf %s format_decimal %s\n",
+			static_cast<double>(value), static_cast<unsigned>(decimals), expected.data(), formatted.data());
+		return false;
+	}
+	return true;
+}
+
+static void run_checks() {
+	uint32_t random{0x2545F491};
+	uint32_t checked{0};
+	uint32_t mismatches{0};
+	for (uint8_t decimals = 0; decimals <= MAX_FORMAT_DECIMALS; decimals++) {
+		for (uint32_t i = 0; i < RANDOM_CHECKS; i++) {
+			mismatches += same_text(random_float(random), decimals) ? 0 : 1;
+			checked++;
+		}
+		for (int32_t i = -2048; i <= 2048; i++) {
+			mismatches += same_text(static_cast<float>(i) / 8.0F, decimals) ? 0 : 1;
+			mismatches += same_text(static_cast<float>(i) / 2.0F, decimals) ? 0 : 1;
+			checked += 2;
+		}
+	}
+	printf("%lu values checked against printf, %lu differ\n",
+		static_cast<unsigned long>(checked), static_cast<unsigned long>(mismatches));
+}
+
+static void run_timing(uint8_t decimals) {
+	static std::array<char, TEXT_SIZE> text{};
+	const uint32_t printf_cycles{measure_cycles(ITERATIONS, [decimals]() {
+		for (const float value : values) {
+			snprintf(text.data(), text.size(), "%.*f", static_cast<int>(decimals), static_cast<double>(value));
+			keep_result(text);
+		}
+	})};
+	const uint32_t format_cycles{measure_cycles(ITERATIONS, [decimals]() {
+		for (const float value : values) {
+			format_decimal(text.data(), text.size(), value, decimals);
+			keep_result(text);
+		}
+	})};
+	char name[32];
+	snprintf(name, sizeof(name), "%u decimals per value", static_cast<unsigned>(decimals));
+	print_comparison(name, printf_cycles / VALUE_COUNT, format_cycles / VALUE_COUNT);
+}
+
+int main() {
+	stdio_init_all();
+	printf("Starting up number format benchmark.\n");
+
+	bi_decl(bi_program_name("number_format_benchmark"));
+	bi_decl(bi_program_description("Checks and times format_decimal() against snprintf()."));
+	bi_decl(bi_program_version_string("1.0.0"));
+	bi_decl(bi_program_url("https://github.com/jacobguenther/pico-libs"));
+	bi_decl(bi_program_feature("License AGPLv3"));
+
+	uint32_t random{0x12345678};
+	for (auto& value : values) {
+		value = random_angle(random);
+	}
+
+	do {
+		run_checks();
+		run_timing(0);
+		run_timing(2);
+		run_timing(MAX_FORMAT_DECIMALS);
+	} while (wait_for_next_run());
+}
@@ -0,0 +1,121 @@
+// File: examples/benchmarks/raw_frame_benchmark.cpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+/*
+Times decoding a full FIFO of raw frames.
+	old: each frame decoded on its own into a (accel, gyro, temp) tuple,
+	     the way decode_fifo_frame() did before RawFrameView
+	new: decode_frames() over a RawFrameView into a SampleBatch
+The sum rows read one channel, old through the tuples and new straight
+out of the view without decoding anything else.
+*/
+
+#include <array>
+#include <tuple>
+
+#include "sample_batch.hpp"
+
+#include "benchmark.hpp"
+
+using Values = std::tuple<std::array<int16_t, 3>, std::array<int16_t, 3>, int16_t>;
+
+constexpr size_t FRAME_COUNT{1024 / RAW_FRAME_WITHOUT_TEMP_SIZE_BYTES};
+constexpr uint32_t ITERATIONS{200};
+
+// the per frame decode RawFrameView replaced
+static Values copy_decode(const uint8_t* frame, bool includes_temperature) {
+	const uint8_t* gyro{includes_temperature ? &frame[8] : &frame[6]};
+	return Values {
+		{
+			static_cast<int16_t>(frame[0] << 8 | frame[1]),
+			static_cast<int16_t>(frame[2] << 8 | frame[3]),
+			static_cast<int16_t>(frame[4] << 8 | frame[5])
+		},
+		{
+			static_cast<int16_t>(gyro[0] << 8 | gyro[1]),
+			static_cast<int16_t>(gyro[2] << 8 | gyro[3]),
+			static_cast<int16_t>(gyro[4] << 8 | gyro[5])
+		},
+		includes_temperature ? static_cast<int16_t>(frame[6] << 8 | frame[7]) : int16_t{0}
+	};
+}
+
+static std::array<uint8_t, FRAME_COUNT * RAW_FRAME_SIZE_BYTES> frames{};
+static std::array<Values, FRAME_COUNT> decoded{};
+static SampleBatch<FRAME_COUNT> batch{};
+
+static bool outputs_match(bool includes_temperature) {
+	const RawFrameView view(frames.data(), FRAME_COUNT, includes_temperature);
+	decode_frames(view, &batch);
+	for (size_t i = 0; i < FRAME_COUNT; i++) {
+		const auto [accel, gyro, temp] = copy_decode(view.frame(i), includes_temperature);
+		for (size_t axis = 0; axis < 3; axis++) {
+			if (accel[axis] != batch.accel[axis][i] || gyro[axis] != batch.gyro[axis][i]) {
+				return false;
+			}
+		}
+		if (temp != batch.temperature[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void run(bool includes_temperature) {
+	const size_t frame_size{includes_temperature ? RAW_FRAME_SIZE_BYTES : RAW_FRAME_WITHOUT_TEMP_SIZE_BYTES};
+	const RawFrameView view(frames.data(), FRAME_COUNT, includes_temperature);
+	printf("%u frames of %u bytes, outputs %s\n",
+		static_cast<unsigned>(FRAME_COUNT), static_cast<unsigned>(frame_size),
+		outputs_match(includes_temperature) ? "match" : "DIFFER");
+
+	const uint32_t copy_cycles{measure_cycles(ITERATIONS, [&]() {
+		for (size_t i = 0; i < FRAME_COUNT; i++) {
+			decoded[i] = copy_decode(&frames[i * frame_size], includes_temperature);
+		}
+		keep_result(decoded);
+	})};
+	const uint32_t view_cycles{measure_cycles(ITERATIONS, [&]() {
+		decode_frames(view, &batch);
+		keep_result(batch);
+	})};
+	print_comparison("decode all channels", copy_cycles, view_cycles);
+
+	const uint32_t copy_sum_cycles{measure_cycles(ITERATIONS, [&]() {
+		int32_t sum{0};
+		for (size_t i = 0; i < FRAME_COUNT; i++) {
+			sum += std::get<0>(copy_decode(&frames[i * frame_size], includes_temperature))[2];
+		}
+		keep_result(sum);
+	})};
+	const uint32_t view_sum_cycles{measure_cycles(ITERATIONS, [&]() {
+		int32_t sum{0};
+		for (size_t i = 0; i < view.size(); i++) {
+			sum += view.accel(i, 2);
+		}
+		keep_result(sum);
+	})};
+	print_comparison("sum accel z", copy_sum_cycles, view_sum_cycles);
+}
+
+int main() {
+	stdio_init_all();
+	printf("Starting up raw frame decode benchmark.\n");
+
+	bi_decl(bi_program_name("raw_frame_benchmark"));
+	bi_decl(bi_program_description("Times RawFrameView batch decoding against per frame copies."));
+	bi_decl(bi_program_version_string("1.0.0"));
+	bi_decl(bi_program_url("https://github.com/jacobguenther/pico-libs"));
+	bi_decl(bi_program_feature("License AGPLv3"));
+
+	uint32_t random{0x12345678};
+	for (auto& byte : frames) {
+		byte = static_cast<uint8_t>(next_random(random));
+	}
+
+	do {
+		run(false);
+		run(true);
+	} while (wait_for_next_run());
+}
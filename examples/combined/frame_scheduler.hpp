@@ -0,0 +1,183 @@
+// File: frame_scheduler.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef FRAME_SCHEDULER_HPP
+#define FRAME_SCHEDULER_HPP
+
+#include <array>   // array
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t, int32_t
+
+#include "pico/stdlib.h"
+
+constexpr size_t MAX_SCHEDULED_TASKS{8};
+constexpr uint32_t FPS_WINDOW_US{1000000};
+
+enum class RenderMode {
+	// render every frame period
+	TARGET_RATE,
+	// render at most once per frame period, only after request_frame()
+	ON_CHANGE,
+};
+
+struct FrameStats {
+	// frames rendered during the last whole second
+	float fps;
+	uint32_t last_frame_us;
+	uint32_t max_frame_us;
+	uint32_t frame_count;
+	// frames that started a period or more late or ran past their period
+	uint32_t deadline_misses;
+};
+
+/*
+Cooperative scheduler for the main loop. Tasks run on their own periods
+and rendering happens at the target frame rate, so a slow display never
+starves input handling and a fast one never spins on redraws.
+
+Tasks that fall behind run once and resynchronise instead of bursting to
+catch up. Everything runs on the calling core, keep tasks short.
+*/
+class FrameScheduler {
+public:
+	using TaskFunction = void (*)(void* context);
+	// Returns the bytes sent to the display.
+	using RenderFunction = size_t (*)(void* context);
+
+	FrameScheduler(uint32_t target_fps, RenderMode mode, RenderFunction render, void* render_context)
+		: _frame_period_us{1000000 / target_fps}
+		, _mode{mode}
+		, _render{render}
+		, _render_context{render_context}
+	{
+		const uint32_t now{time_us_32()};
+		_next_frame_us = now;
+		_fps_window_start_us = now;
+	}
+	~FrameScheduler()=default;
+
+	FrameScheduler(const FrameScheduler&)=delete;
+	FrameScheduler(const FrameScheduler&&)=delete;
+	FrameScheduler& operator=(const FrameScheduler&)=delete;
+	FrameScheduler& operator=(const FrameScheduler&&)=delete;
+
+	bool add_task(uint32_t period_us, TaskFunction function, void* context) {
+		if (_task_count == MAX_SCHEDULED_TASKS) {
+			printf("FrameScheduler: too many tasks\n");
+			return false;
+		}
+		_tasks[_task_count] = Task{function, context, period_us, time_us_32()};
+		_task_count++;
+		return true;
+	}
+	// For ON_CHANGE, the next frame slot renders.
+	void request_frame() {
+		_frame_requested = true;
+	}
+
+	// Runs the tasks that are due, then the frame if it is due.
+	void run_once() {
+		for (size_t i = 0; i < _task_count; i++) {
+			Task& task{_tasks[i]};
+			const uint32_t now{time_us_32()};
+			if (!due(now, task.next_us)) {
+				continue;
+			}
+			task.function(task.context);
+			task.next_us = next_deadline(task.next_us, task.period_us, now);
+		}
+
+		const uint32_t now{time_us_32()};
+		update_fps(now);
+		if (!due(now, _next_frame_us)) {
+			return;
+		}
+		if (_mode == RenderMode::ON_CHANGE && !_frame_requested) {
+			_next_frame_us = next_deadline(_next_frame_us, _frame_period_us, now);
+			return;
+		}
+		_frame_requested = false;
+		render_frame(now);
+	}
+	[[noreturn]] void run() {
+		while (true) {
+			run_once();
+			tight_loop_contents();
+		}
+	}
+
+	FrameStats stats() const {
+		return FrameStats {
+			_fps,
+			_last_frame_us,
+			_max_frame_us,
+			_frame_count,
+			_deadline_misses
+		};
+	}
+	size_t last_frame_bytes() const {
+		return _last_frame_bytes;
+	}
+private:
+	struct Task {
+		TaskFunction function;
+		void* context;
+		uint32_t period_us;
+		uint32_t next_us;
+	};
+
+	// time_us_32() wraps, compare through the signed difference
+	static bool due(uint32_t now, uint32_t deadline) {
+		return static_cast<int32_t>(now - deadline) >= 0;
+	}
+	static uint32_t next_deadline(uint32_t deadline, uint32_t period, uint32_t now) {
+		const uint32_t next{deadline + period};
+		return due(now, next) ? now + period : next;
+	}
+
+	void render_frame(uint32_t start) {
+		const bool started_late{static_cast<int32_t>(start - _next_frame_us) >= static_cast<int32_t>(_frame_period_us)};
+		_last_frame_bytes = _render(_render_context);
+		const uint32_t end{time_us_32()};
+
+		_last_frame_us = end - start;
+		_max_frame_us = _last_frame_us > _max_frame_us ? _last_frame_us : _max_frame_us;
+		if (started_late || _last_frame_us > _frame_period_us) {
+			_deadline_misses++;
+		}
+		_frame_count++;
+		_next_frame_us = next_deadline(_next_frame_us, _frame_period_us, end);
+	}
+	void update_fps(uint32_t now) {
+		const uint32_t window{now - _fps_window_start_us};
+		if (window < FPS_WINDOW_US) {
+			return;
+		}
+		_fps = static_cast<float>(_frame_count - _fps_window_frames) * 1000000.0F / static_cast<float>(window);
+		_fps_window_start_us = now;
+		_fps_window_frames = _frame_count;
+	}
+
+	uint32_t _frame_period_us;
+	RenderMode _mode;
+	RenderFunction _render;
+	void* _render_context;
+	bool _frame_requested{true};
+	uint32_t _next_frame_us{0};
+
+	std::array<Task, MAX_SCHEDULED_TASKS> _tasks{};
+	size_t _task_count{0};
+
+	float _fps{0.0F};
+	uint32_t _fps_window_start_us{0};
+	uint32_t _fps_window_frames{0};
+	uint32_t _last_frame_us{0};
+	uint32_t _max_frame_us{0};
+	uint32_t _frame_count{0};
+	uint32_t _deadline_misses{0};
+	size_t _last_frame_bytes{0};
+};
+
+#endif
@@ -28,6 +28,19 @@ extern "C" {
 #include "mpu6050_config.hpp"
 #include "median_filter.hpp"
 #include "complementary_filter.hpp"
+#include "sensor_pipeline.hpp"
+
+#include "number_format.hpp"
+
+#include "ui.hpp"
+#include "frame_scheduler.hpp"
+#include "perf_hud.hpp"
+
+// 1 replaces the key event log with runtime metrics and prints the
+// full redraw time with and without the text cache at start up
+#ifndef COMBINED_PERF_HUD
+#define COMBINED_PERF_HUD 0
+#endif
 
 constexpr uint8_t ROW_COUNT{3};
 constexpr uint8_t COL_COUNT{3};
@@ -43,107 +56,196 @@ const color_t black = hagl_color(0, 0, 0);
 const color_t white = hagl_color(255, 255, 255);
 
 constexpr int16_t header_offset_x{2};
-constexpr int16_t header_height{12};
 constexpr int16_t header_following_space{2};
 constexpr int16_t header_width{DISPLAY_WIDTH - 1 - header_offset_x};
 
 constexpr int16_t menu_item_width{40};
 constexpr int16_t menu_item_x_spacing{2};
 
-constexpr int16_t header_text_offset_x{2};
-constexpr int16_t header_text_offset_y{2};
-
 constexpr int16_t line_height{9};
 constexpr int16_t line_indent{4};
+constexpr int16_t line_width{DISPLAY_WIDTH - line_indent};
+
+constexpr size_t event_line_count{5};
+
+constexpr size_t mean_filter_size{9};
+
+constexpr uint32_t target_fps{30};
+constexpr uint32_t sensor_task_period_us{5000};
+constexpr uint32_t keyboard_task_period_us{1000};
+constexpr uint32_t stats_task_period_us{5000000};
+constexpr uint32_t perf_hud_task_period_us{1000000};
+
+constexpr int16_t menu_y{header_following_space};
+constexpr int16_t events_header_y{menu_y + UI_HEADER_HEIGHT + header_following_space};
+constexpr int16_t event_log_y{events_header_y + UI_HEADER_HEIGHT + header_following_space};
+constexpr int16_t mpu_header_y{event_log_y + line_height * static_cast<int16_t>(event_line_count)};
+constexpr int16_t pitch_y{mpu_header_y + UI_HEADER_HEIGHT + header_following_space};
+constexpr int16_t roll_y{pitch_y + line_height};
+
+constexpr int16_t menu_item_x(int16_t index) {
+	return header_offset_x + index * (menu_item_width + menu_item_x_spacing);
+}
+
+struct ControllerScreen {
+	ControllerScreen(bitmap_t* framebuffer, TextCache* text_cache)
+		: screen(framebuffer, text_cache, black)
+	{
+		screen.add(&events_menu);
+		screen.add(&config_menu);
+		screen.add(&other_menu);
+		screen.add(&events_header);
+#if COMBINED_PERF_HUD
+		screen.add(&perf_hud);
+#else
+		screen.add(&event_log);
+#endif
+		screen.add(&mpu_header);
+		screen.add(&pitch);
+		screen.add(&roll);
+	}
 
-// struct AppState {
-// 	key_events;
-// }
-struct ScreenText {
-	std::array<char[32], 3> top_menue = {"Events", "Config", "Other"};
-	char events_header[32] = "Key Events";
-	size_t most_recent_event_line{0};
-	std::array<char[32], 5> scrolling_event_lines;
-	char mpu_header[32] = "MPU-6050";
-	float pitch{0.0F};
-	float roll{0.0F};
+	BoxedHeader events_menu{menu_item_x(0), menu_y, menu_item_x(0) + menu_item_width, green, "Events"};
+	BoxedHeader config_menu{menu_item_x(1), menu_y, menu_item_x(1) + menu_item_width, red, "Config"};
+	BoxedHeader other_menu{menu_item_x(2), menu_y, menu_item_x(2) + menu_item_width, red, "Other"};
+	BoxedHeader events_header{header_offset_x, events_header_y, header_width, red, "Key Events"};
+	ScrollingLog<event_line_count> event_log{line_indent, event_log_y, line_width, line_height, blue};
+	// shares the event log's place on screen
+	PerfHud perf_hud{line_indent, event_log_y, line_width, line_height, white};
+	static_assert(PERF_HUD_LINE_COUNT == event_line_count, "the hud covers exactly the event log");
+	BoxedHeader mpu_header{header_offset_x, mpu_header_y, header_width, red, "MPU-6050"};
+	NumericReadout pitch{line_indent, pitch_y, line_width, blue, "Pitch: ", 2};
+	NumericReadout roll{line_indent, roll_y, line_width, blue, "Roll:  ", 2};
+
+	Screen<8> screen;
 };
 
-void draw_screen_text(ScreenText* screen_text) {
-		int16_t y_pos{header_following_space};
-		int16_t x_pos{header_offset_x};
-		wchar_t line[32];
-
-		// Draw key event header
-		auto first{true};
-		color_t color = green;
-		for (const auto& menu_text: screen_text->top_menue) {
-			swprintf(line, sizeof(line), L"%s", menu_text);
-			hagl_draw_rounded_rectangle(
-				x_pos,
-				y_pos,
-				x_pos + menu_item_width,
-				y_pos + header_height,
-				2, color);
-			hagl_put_text(line,
-				x_pos + header_text_offset_x,
-				y_pos + header_text_offset_y,
-				color, font6x9);
-			x_pos += menu_item_width + menu_item_x_spacing;
-			if (first) {
-				first = false;
-				color = red;
-			}
-		}
+using ControllerPipeline = SensorPipeline<ComplementaryFilter, mean_filter_size>;
+using ControllerKeyboard = PIOKeyboard<ROW_COUNT, COL_COUNT>;
 
-		y_pos += header_height + header_following_space;
-		
-		swprintf(line, sizeof(line), L"%s", screen_text->events_header);
-		hagl_draw_rounded_rectangle(
-			header_offset_x,
-			y_pos,
-			header_width,
-			y_pos + header_height,
-			2, red);
-		hagl_put_text(line,
-			header_offset_x + header_text_offset_x,
-			y_pos + header_text_offset_y,
-			red, font6x9);
-		y_pos += header_height + header_following_space;
-
-		// Draw key events
-		for (size_t i = screen_text->most_recent_event_line; i < 5; i++) {
-			swprintf(line, sizeof(line), L"%s", screen_text->scrolling_event_lines[i]);
-			hagl_put_text(line, line_indent, y_pos, blue, font6x9);
-			y_pos += line_height;
-		}
-		for (size_t i = 0; i < screen_text->most_recent_event_line; i++) {
-			swprintf(line, sizeof(line), L"%s", screen_text->scrolling_event_lines[i]);
-			hagl_put_text(line, line_indent, y_pos, blue, font6x9);
-			y_pos += line_height;
+// What the scheduled tasks work on.
+struct ControllerTasks {
+	ControllerPipeline* sensor_pipeline;
+	ControllerKeyboard* keyboard;
+	ControllerScreen* screen;
+	FrameScheduler* scheduler;
+
+	// hot path counters for the perf hud
+	uint32_t key_events;
+	float fps;
+	float display_bytes_per_second;
+};
+
+void sensor_task(void* context) {
+	auto* tasks{static_cast<ControllerTasks*>(context)};
+	PipelineResult angles{};
+	if (tasks->sensor_pipeline->poll(&angles)) {
+		tasks->screen->pitch.set_value(angles.pitch);
+		tasks->screen->roll.set_value(angles.roll);
+		tasks->scheduler->request_frame();
+	}
+}
+
+void keyboard_task(void* context) {
+	auto* tasks{static_cast<ControllerTasks*>(context)};
+	ControllerKeyboard* keyboard{tasks->keyboard};
+	if (!keyboard->available()) {
+		return;
+	}
+	keyboard->poll_buttons();
+	keyboard->print_key_events();
+
+	ScrollingLog<event_line_count>& event_log{tasks->screen->event_log};
+	const size_t event_count{keyboard->drain_events([&event_log](const KeyEvent& event) {
+		char line[UI_TEXT_LENGTH];
+		switch (event.event_type) {
+			case KeyEventE::KEY_UP:
+				snprintf(line, sizeof(line), "UP   %i", event.key_index);
+				break;
+			case KeyEventE::KEY_DOWN:
+				snprintf(line, sizeof(line), "DOWN %i", event.key_index);
+				break;
 		}
+		event_log.push(line);
+	})};
+	if (event_count > 0) {
+		tasks->key_events += event_count;
+		tasks->scheduler->request_frame();
+	}
+}
+
+void stats_task(void* context) {
+	auto* tasks{static_cast<ControllerTasks*>(context)};
+	const FrameStats stats{tasks->scheduler->stats()};
+	char fps_text[MAX_FORMAT_LENGTH + 1]{};
+	format_decimal(fps_text, sizeof(fps_text), stats.fps, 1);
+	printf("fps: %s frame: %lu us max: %lu us frames: %lu missed: %lu\n",
+		fps_text,
+		static_cast<unsigned long>(stats.last_frame_us),
+		static_cast<unsigned long>(stats.max_frame_us),
+		static_cast<unsigned long>(stats.frame_count),
+		static_cast<unsigned long>(stats.deadline_misses));
+	printf("key states: %lu dropped: %lu rx stalls: %lu\n",
+		static_cast<unsigned long>(tasks->keyboard->states_processed()),
+		static_cast<unsigned long>(tasks->keyboard->states_dropped()),
+		static_cast<unsigned long>(tasks->keyboard->rx_stall_count()));
+}
 
-		// draw mpu header
-		swprintf(line, sizeof(line), L"%s", screen_text->mpu_header);
-		hagl_put_text(line,
-			header_offset_x + header_text_offset_x,
-			y_pos + header_text_offset_y,
-			red, font6x9);
-		hagl_draw_rounded_rectangle(
-			header_offset_x,
-			y_pos,
-			header_width,
-			y_pos + header_height,
-			2, red);
-		y_pos += header_height + header_following_space;
-
-		// draw mpu values
-		swprintf(line, sizeof(line), L"Pitch: %.2f", screen_text->pitch);
-		hagl_put_text(line, line_indent, y_pos, blue, font6x9);
-		y_pos += line_height;
-
-		swprintf(line, sizeof(line), L"Roll:  %.2f", screen_text->roll);
-		hagl_put_text(line, line_indent, y_pos, blue, font6x9);
+void perf_hud_task(void* context) {
+	auto* tasks{static_cast<ControllerTasks*>(context)};
+	const PipelineStats pipeline_stats{tasks->sensor_pipeline->stats()};
+	tasks->screen->perf_hud.update(PerfSample {
+		time_us_32(),
+		tasks->fps,
+		tasks->display_bytes_per_second,
+		pipeline_stats.samples_processed,
+		pipeline_stats.samples_dropped,
+		tasks->key_events,
+		pipeline_stats.read_us,
+		pipeline_stats.filter_us,
+		tasks->screen->screen.last_timing()
+	});
+	if (tasks->screen->perf_hud.dirty()) {
+		tasks->scheduler->request_frame();
+	}
+}
+
+#if COMBINED_PERF_HUD
+constexpr uint32_t text_cache_compare_frames{16};
+
+// Average draw time of a full redraw, after one frame to warm up.
+uint32_t average_full_redraw_us(ControllerScreen* controller_screen) {
+	controller_screen->screen.invalidate();
+	controller_screen->screen.render();
+	uint32_t total_us{0};
+	for (uint32_t i = 0; i < text_cache_compare_frames; i++) {
+		controller_screen->screen.invalidate();
+		controller_screen->screen.render();
+		total_us += controller_screen->screen.last_timing().draw_us;
+	}
+	return total_us / text_cache_compare_frames;
+}
+// Frame time with and without the text tile cache, once at start up.
+void compare_text_cache(ControllerScreen* controller_screen, TextCache* text_cache) {
+	const uint32_t cached_us{average_full_redraw_us(controller_screen)};
+	controller_screen->screen.set_text_cache(nullptr);
+	const uint32_t uncached_us{average_full_redraw_us(controller_screen)};
+	controller_screen->screen.set_text_cache(text_cache);
+	printf("full redraw draw time, text cache: %lu us, no text cache: %lu us\n",
+		static_cast<unsigned long>(cached_us),
+		static_cast<unsigned long>(uncached_us));
+}
+#endif
+
+size_t render_task(void* context) {
+	auto* tasks{static_cast<ControllerTasks*>(context)};
+	// only the widgets that changed are redrawn and sent
+	const size_t bytes{tasks->screen->screen.render()};
+	if (bytes > 0) {
+		tasks->fps = fps();
+		tasks->display_bytes_per_second = aps(static_cast<uint32_t>(bytes));
+	}
+	return bytes;
 }
 
 int main() {
@@ -190,9 +292,8 @@ int main() {
 	const float tau_s{tau_ms / 1000.0F};
 	const float gyro_bias{tau_s / (tau_s + dt)};
 
-	const uint32_t mean_filter_size{9};
-
-	MPU6050 mpu0 = MPU6050(
+	// large objects are static, core0 only has a 2 KB stack
+	static MPU6050 mpu0 = MPU6050(
 		i2c0,
 		MPU6050Address::DEFAULT,
 		mpu_interrupt_pin,
@@ -201,75 +302,50 @@ int main() {
 		accel_fs,
 		gyro_fs
 	);
+	if (!mpu0.ok()) {
+		printf("Failed to start the MPU-6050.\n");
+	}
 
-	MedianFilter<mean_filter_size> accel_x_filter;
-	MedianFilter<mean_filter_size> accel_y_filter;
-	MedianFilter<mean_filter_size> accel_z_filter;
-	ComplementaryFilter comp_filter = ComplementaryFilter(dt, gyro_bias);
-
-	auto pio_keyboard = PIOKeyboard<ROW_COUNT, COL_COUNT>(FIRAT_ROW_PIN, FIRST_COL_PIN, pio0);
+	static ComplementaryFilter comp_filter = ComplementaryFilter(dt, gyro_bias);
+	// reads and filters the mpu on core1, the display no longer holds up sampling
+	static ControllerPipeline sensor_pipeline(&mpu0, &comp_filter);
+	if (!sensor_pipeline.start()) {
+		printf("Failed to start the sensor pipeline.\n");
+	}
 
-	ScreenText screen_text;
-	for (auto& line: screen_text.scrolling_event_lines) {
-		sprintf(line, "0");
+	static auto pio_keyboard = ControllerKeyboard(FIRAT_ROW_PIN, FIRST_COL_PIN, pio0, PIOKeyboardMode::DMA);
+	if (!pio_keyboard.ok()) {
+		printf("Failed to start the PIO keyboard.\n");
+	} else if (pio_keyboard.mode() != PIOKeyboardMode::DMA) {
+		printf("Not enough free DMA channels, polling the PIO keyboard's FIFOs instead.\n");
 	}
 
-	hagl_init();
+	bitmap_t* framebuffer = hagl_init();
 	hagl_clear_screen();
 	hagl_set_clip_window(0, 0, DISPLAY_WIDTH -1, DISPLAY_HEIGHT - 1);
-	size_t bytes = hagl_flush();
-
-	printf("Entering main loop.\n");
-	while (true) {
-		if (mpu0.available()) {
-			mpu0.read_data_from_device();
-
-			auto [accel, gyro] = mpu0.get_offset_accel_and_scaled_gyros();
-			accel_x_filter.update(accel[0]);
-			accel_y_filter.update(accel[1]);
-			accel_z_filter.update(accel[2]);
-			std::array<int16_t, 3> filtered_accel = {
-				accel_x_filter.get_median(),
-				accel_y_filter.get_median(),
-				accel_z_filter.get_median()
-			};
-			comp_filter.update(filtered_accel, gyro);
-			std::tie(screen_text.pitch, screen_text.roll) = comp_filter.get_filtered_angles();
-
-			// printf("pitch: %.2f roll: %.2f\n", pitch, roll);
-		}
+	hagl_flush();
 
-		if (pio_keyboard.available()) {
-			pio_keyboard.poll_buttons();
-			pio_keyboard.print_key_events();
-
-			size_t event_count{0};
-			auto events_ptr = pio_keyboard.get_event_ptr(&event_count);
-			for (size_t i = 0; i < event_count; i++) {
-				if (screen_text.most_recent_event_line == 0) {
-					screen_text.most_recent_event_line = 4;
-				} else {
-					screen_text.most_recent_event_line--;
-				}
-
-				const auto event = events_ptr[i];
-				switch (event.event_type) {
-					case KeyEventE::KEY_UP:
-						sprintf(screen_text.scrolling_event_lines[screen_text.most_recent_event_line], "UP   %i", event.key_index);
-						break;
-					case KeyEventE::KEY_DOWN:
-						sprintf(screen_text.scrolling_event_lines[screen_text.most_recent_event_line], "DOWN %i", event.key_index);
-				}
-			}
-			pio_keyboard.clear_events();
-		}
-
-		hagl_clear_screen();
-		draw_screen_text(&screen_text);
-		bytes = hagl_flush();
+	// headers and readout prefixes are rendered once and then copied
+	static TextCache text_cache;
+	static ControllerScreen controller_screen(framebuffer, &text_cache);
+	for (size_t i = 0; i < event_line_count; i++) {
+		controller_screen.event_log.push("0");
 	}
+#if COMBINED_PERF_HUD
+	compare_text_cache(&controller_screen, &text_cache);
+#endif
+
+	// renders at most target_fps, only when a task changed something
+	static ControllerTasks tasks{&sensor_pipeline, &pio_keyboard, &controller_screen, nullptr, 0, 0.0F, 0.0F};
+	static FrameScheduler scheduler(target_fps, RenderMode::ON_CHANGE, render_task, &tasks);
+	tasks.scheduler = &scheduler;
+	scheduler.add_task(sensor_task_period_us, sensor_task, &tasks);
+	scheduler.add_task(keyboard_task_period_us, keyboard_task, &tasks);
+	scheduler.add_task(stats_task_period_us, stats_task, &tasks);
+#if COMBINED_PERF_HUD
+	scheduler.add_task(perf_hud_task_period_us, perf_hud_task, &tasks);
+#endif
 
-	hagl_close();
-
-	return 0;
-}
\ No newline at end of file
+	printf("Entering main loop.\n");
+	scheduler.run();
+}
@@ -0,0 +1,88 @@
+// File: perf_hud.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef PERF_HUD_HPP
+#define PERF_HUD_HPP
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
+#include <cstdio>  // snprintf
+
+#include "number_format.hpp"
+#include "ui.hpp"
+
+constexpr size_t PERF_HUD_LINE_COUNT{5};
+
+// Counters read once per HUD update, totals are turned into rates here.
+struct PerfSample {
+	uint32_t time_us;
+	// hagl fps() and aps() of the bytes sent per frame
+	float fps;
+	float display_bytes_per_second;
+	uint32_t samples_processed;
+	uint32_t samples_dropped;
+	uint32_t key_events;
+	uint32_t read_us;
+	uint32_t filter_us;
+	RenderTiming render;
+};
+
+/*
+Five lines of runtime metrics, sized to fit 21 columns:
+	fps 30.0 spi 12.3k   frames per second and display KiB/s
+	imu 100/s drop 0     filtered samples per second, samples lost
+	keys 2/s             key events per second
+	read 250 filt 40us   i2c read and filter time for the newest sample
+	draw 900 flush 3000  time in the last frame that sent anything, us
+*/
+class PerfHud : public TextBlock<PERF_HUD_LINE_COUNT> {
+public:
+	PerfHud(int16_t x, int16_t y, int16_t width, int16_t line_height, color_t color)
+		: TextBlock<PERF_HUD_LINE_COUNT>(x, y, width, line_height, color)
+	{}
+
+	void update(const PerfSample& sample) {
+		const uint32_t elapsed_us{sample.time_us - _previous.time_us};
+		if (_has_previous && elapsed_us > 0) {
+			write_lines(sample, elapsed_us);
+		}
+		_previous = sample;
+		_has_previous = true;
+	}
+private:
+	static uint32_t per_second(uint32_t count, uint32_t elapsed_us) {
+		return static_cast<uint32_t>((static_cast<uint64_t>(count) * 1000000U + elapsed_us / 2) / elapsed_us);
+	}
+	void write_lines(const PerfSample& sample, uint32_t elapsed_us) {
+		char fps_text[MAX_FORMAT_LENGTH + 1]{};
+		char kib_text[MAX_FORMAT_LENGTH + 1]{};
+		format_decimal(fps_text, sizeof(fps_text), sample.fps, 1);
+		format_decimal(kib_text, sizeof(kib_text), sample.display_bytes_per_second / 1024.0F, 1);
+
+		char line[UI_TEXT_LENGTH]{};
+		std::snprintf(line, sizeof(line), "fps %s spi %sk", fps_text, kib_text);
+		set_line(0, line);
+		std::snprintf(line, sizeof(line), "imu %lu/s drop %lu",
+			static_cast<unsigned long>(per_second(sample.samples_processed - _previous.samples_processed, elapsed_us)),
+			static_cast<unsigned long>(sample.samples_dropped));
+		set_line(1, line);
+		std::snprintf(line, sizeof(line), "keys %lu/s",
+			static_cast<unsigned long>(per_second(sample.key_events - _previous.key_events, elapsed_us)));
+		set_line(2, line);
+		std::snprintf(line, sizeof(line), "read %lu filt %luus",
+			static_cast<unsigned long>(sample.read_us),
+			static_cast<unsigned long>(sample.filter_us));
+		set_line(3, line);
+		std::snprintf(line, sizeof(line), "draw %lu flush %lu",
+			static_cast<unsigned long>(sample.render.draw_us),
+			static_cast<unsigned long>(sample.render.flush_us));
+		set_line(4, line);
+	}
+
+	PerfSample _previous{};
+	bool _has_previous{false};
+};
+
+#endif
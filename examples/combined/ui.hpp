@@ -0,0 +1,488 @@
+// File: ui.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef UI_HPP
+#define UI_HPP
+
+#include <algorithm> // copy, fill, min
+#include <array>   // array
+#include <cstddef> // size_t
+#include <cstdint> // int16_t, uint32_t
+#include <cstring> // strncmp, strncpy
+
+#include "pico/stdlib.h"
+
+extern "C" {
+	#include <hagl_hal.h>
+	#include <hagl.h>
+	#include <font6x9.h>
+	#include <mipi_display.h>
+}
+
+#include "number_format.hpp"
+
+constexpr size_t UI_TEXT_LENGTH{32};
+constexpr int16_t UI_GLYPH_WIDTH{6};
+constexpr int16_t UI_GLYPH_HEIGHT{9};
+constexpr int16_t UI_HEADER_HEIGHT{12};
+constexpr int16_t UI_HEADER_TEXT_OFFSET{2};
+constexpr int16_t UI_HEADER_RADIUS{2};
+constexpr size_t UI_TEXT_CACHE_ENTRIES{16};
+constexpr size_t UI_TEXT_CACHE_PIXELS{4096};
+constexpr size_t UI_MAX_GLYPH_PIXELS{16 * 16};
+
+// Time spent by the last Screen::render() that sent anything.
+struct RenderTiming {
+	uint32_t draw_us;
+	uint32_t flush_us;
+};
+
+// Inclusive pixel bounds.
+struct Rect {
+	int16_t x0;
+	int16_t y0;
+	int16_t x1;
+	int16_t y1;
+};
+
+/*
+Strings rendered once into RGB565 tiles. Misses render glyph by glyph with
+hagl_get_glyph(), which leaves unset pixels 0x0000, so tiles suit a black
+background. When the pixel pool is full get() returns nullptr.
+*/
+class TextCache {
+public:
+	struct Tile {
+		char text[UI_TEXT_LENGTH];
+		color_t color;
+		uint16_t width;
+		uint16_t height;
+		size_t offset;
+	};
+
+	TextCache()=default;
+	~TextCache()=default;
+
+	TextCache(const TextCache&)=delete;
+	TextCache(const TextCache&&)=delete;
+	TextCache& operator=(const TextCache&)=delete;
+	TextCache& operator=(const TextCache&&)=delete;
+
+	const Tile* get(const char* text, color_t color) {
+		for (size_t i = 0; i < _tile_count; i++) {
+			const Tile& tile{_tiles[i]};
+			if (tile.color == color && std::strncmp(tile.text, text, UI_TEXT_LENGTH - 1) == 0) {
+				return &tile;
+			}
+		}
+		return render(text, color);
+	}
+	const color_t* pixels(const Tile& tile) const {
+		return &_pixels[tile.offset];
+	}
+	size_t used_pixels() const {
+		return _used_pixels;
+	}
+private:
+	const Tile* render(const char* text, color_t color) {
+		if (_tile_count == UI_TEXT_CACHE_ENTRIES) {
+			return nullptr;
+		}
+		std::array<color_t, UI_MAX_GLYPH_PIXELS> glyph_pixels{};
+		bitmap_t glyph{};
+		glyph.buffer = reinterpret_cast<uint8_t*>(glyph_pixels.data());
+
+		// measure first, glyph widths come from the font
+		uint16_t width{0};
+		uint16_t height{0};
+		size_t length{0};
+		for (; length < UI_TEXT_LENGTH - 1 && text[length] != '\0'; length++) {
+			if (hagl_get_glyph(static_cast<wchar_t>(text[length]), color, &glyph, font6x9) != 0) {
+				return nullptr;
+			}
+			width += glyph.width;
+			height = glyph.height > height ? glyph.height : height;
+		}
+		if (static_cast<size_t>(width) * height > UI_TEXT_CACHE_PIXELS - _used_pixels) {
+			return nullptr;
+		}
+
+		Tile& tile{_tiles[_tile_count]};
+		std::strncpy(tile.text, text, UI_TEXT_LENGTH - 1);
+		tile.text[UI_TEXT_LENGTH - 1] = '\0';
+		tile.color = color;
+		tile.width = width;
+		tile.height = height;
+		tile.offset = _used_pixels;
+
+		color_t* destination{&_pixels[tile.offset]};
+		std::fill(destination, destination + width * height, color_t{0});
+		uint16_t x{0};
+		for (size_t i = 0; i < length; i++) {
+			hagl_get_glyph(static_cast<wchar_t>(text[i]), color, &glyph, font6x9);
+			for (uint16_t row = 0; row < glyph.height; row++) {
+				std::copy(
+					glyph_pixels.begin() + row * glyph.width,
+					glyph_pixels.begin() + (row + 1) * glyph.width,
+					destination + row * width + x);
+			}
+			x += glyph.width;
+		}
+
+		_used_pixels += static_cast<size_t>(width) * height;
+		_tile_count++;
+		return &tile;
+	}
+
+	std::array<Tile, UI_TEXT_CACHE_ENTRIES> _tiles{};
+	size_t _tile_count{0};
+	std::array<color_t, UI_TEXT_CACHE_PIXELS> _pixels{};
+	size_t _used_pixels{0};
+};
+
+/*
+What widgets draw with. Static text is blitted from the cache straight
+into the back buffer, dynamic text goes through hagl_put_text(). Without
+a cache static text is drawn like dynamic text.
+*/
+class Canvas {
+public:
+	Canvas(bitmap_t* framebuffer, TextCache* cache)
+		: _framebuffer{framebuffer}
+		, _cache{cache}
+	{}
+
+	void set_text_cache(TextCache* cache) {
+		_cache = cache;
+	}
+
+	// Returns the width drawn.
+	int16_t draw_text(const char* text, int16_t x, int16_t y, color_t color) const {
+		std::array<wchar_t, UI_TEXT_LENGTH> line{};
+		for (size_t i = 0; i < UI_TEXT_LENGTH - 1 && text[i] != '\0'; i++) {
+			line[i] = static_cast<wchar_t>(text[i]);
+		}
+		return static_cast<int16_t>(hagl_put_text(line.data(), x, y, color, font6x9));
+	}
+	// For text that never changes, rendered once and then copied.
+	int16_t draw_static_text(const char* text, int16_t x, int16_t y, color_t color) const {
+		const TextCache::Tile* tile{_cache == nullptr ? nullptr : _cache->get(text, color)};
+		if (tile == nullptr) {
+			return draw_text(text, x, y, color);
+		}
+		blit(*tile, x, y);
+		return static_cast<int16_t>(tile->width);
+	}
+private:
+	void blit(const TextCache::Tile& tile, int16_t x, int16_t y) const {
+		const int32_t first_column{x < 0 ? -x : 0};
+		const int32_t last_column{std::min<int32_t>(tile.width, _framebuffer->width - x)};
+		if (first_column >= last_column) {
+			return;
+		}
+		const color_t* source{_cache->pixels(tile)};
+		for (int32_t row = 0; row < tile.height; row++) {
+			const int32_t target_y{y + row};
+			if (target_y < 0 || target_y >= _framebuffer->height) {
+				continue;
+			}
+			auto* target{reinterpret_cast<color_t*>(_framebuffer->buffer + target_y * _framebuffer->pitch)};
+			std::copy(
+				source + row * tile.width + first_column,
+				source + row * tile.width + last_column,
+				target + x + first_column);
+		}
+	}
+
+	bitmap_t* _framebuffer;
+	TextCache* _cache;
+};
+
+/*
+Retained mode widget. Setters only mark the widget dirty when what it
+shows changes, Screen::render() redraws dirty widgets inside their bounds.
+*/
+class Widget {
+public:
+	explicit Widget(Rect bounds)
+		: _bounds{bounds}
+	{}
+	virtual ~Widget()=default;
+
+	Widget(const Widget&)=delete;
+	Widget(const Widget&&)=delete;
+	Widget& operator=(const Widget&)=delete;
+	Widget& operator=(const Widget&&)=delete;
+
+	const Rect& bounds() const {
+		return _bounds;
+	}
+	bool dirty() const {
+		return _dirty;
+	}
+	void mark_dirty() {
+		_dirty = true;
+	}
+	void clear_dirty() {
+		_dirty = false;
+	}
+	// Draws over an already cleared background.
+	virtual void draw(const Canvas& canvas) const = 0;
+protected:
+	// copies text and marks the widget dirty if it differs from buffer
+	bool set_text(char* buffer, const char* text) {
+		if (std::strncmp(buffer, text, UI_TEXT_LENGTH - 1) == 0) {
+			return false;
+		}
+		std::strncpy(buffer, text, UI_TEXT_LENGTH - 1);
+		buffer[UI_TEXT_LENGTH - 1] = '\0';
+		_dirty = true;
+		return true;
+	}
+private:
+	Rect _bounds;
+	bool _dirty{true};
+};
+
+// One line of text.
+class Label : public Widget {
+public:
+	Label(int16_t x, int16_t y, int16_t width, color_t color, const char* text)
+		: Widget(Rect{x, y, static_cast<int16_t>(x + width - 1), static_cast<int16_t>(y + UI_GLYPH_HEIGHT - 1)})
+		, _color{color}
+	{
+		set_text(_text, text);
+	}
+	void set(const char* text) {
+		set_text(_text, text);
+	}
+	void draw(const Canvas& canvas) const override {
+		canvas.draw_text(_text, bounds().x0, bounds().y0, _color);
+	}
+private:
+	color_t _color;
+	char _text[UI_TEXT_LENGTH]{};
+};
+
+// Text inside a rounded outline, used for headers and menu items.
+class BoxedHeader : public Widget {
+public:
+	BoxedHeader(int16_t x0, int16_t y0, int16_t x1, color_t color, const char* text)
+		: Widget(Rect{x0, y0, x1, static_cast<int16_t>(y0 + UI_HEADER_HEIGHT)})
+		, _color{color}
+	{
+		set_text(_text, text);
+	}
+	void set_color(color_t color) {
+		if (color != _color) {
+			_color = color;
+			mark_dirty();
+		}
+	}
+	void draw(const Canvas& canvas) const override {
+		const Rect& box{bounds()};
+		hagl_draw_rounded_rectangle(box.x0, box.y0, box.x1, box.y1, UI_HEADER_RADIUS, _color);
+		canvas.draw_static_text(_text,
+			box.x0 + UI_HEADER_TEXT_OFFSET,
+			box.y0 + UI_HEADER_TEXT_OFFSET,
+			_color);
+	}
+private:
+	color_t _color;
+	char _text[UI_TEXT_LENGTH]{};
+};
+
+// Newest line on top, older lines scroll down and fall off the bottom.
+template<size_t line_count>
+class ScrollingLog : public Widget {
+public:
+	ScrollingLog(int16_t x, int16_t y, int16_t width, int16_t line_height, color_t color)
+		: Widget(Rect{x, y, static_cast<int16_t>(x + width - 1), static_cast<int16_t>(y + line_height * line_count - 1)})
+		, _line_height{line_height}
+		, _color{color}
+	{}
+	void push(const char* text) {
+		_newest = _newest == 0 ? line_count - 1 : _newest - 1;
+		std::strncpy(_lines[_newest], text, UI_TEXT_LENGTH - 1);
+		_lines[_newest][UI_TEXT_LENGTH - 1] = '\0';
+		mark_dirty();
+	}
+	void draw(const Canvas& canvas) const override {
+		int16_t y{bounds().y0};
+		for (size_t i = 0; i < line_count; i++) {
+			canvas.draw_text(_lines[(_newest + i) % line_count], bounds().x0, y, _color);
+			y += _line_height;
+		}
+	}
+private:
+	int16_t _line_height;
+	color_t _color;
+	size_t _newest{0};
+	char _lines[line_count][UI_TEXT_LENGTH]{};
+};
+
+// Fixed lines replaced in place, only changed text marks the block dirty.
+template<size_t line_count>
+class TextBlock : public Widget {
+public:
+	TextBlock(int16_t x, int16_t y, int16_t width, int16_t line_height, color_t color)
+		: Widget(Rect{x, y, static_cast<int16_t>(x + width - 1), static_cast<int16_t>(y + line_height * line_count - 1)})
+		, _line_height{line_height}
+		, _color{color}
+	{}
+	void set_line(size_t index, const char* text) {
+		if (index < line_count) {
+			set_text(_lines[index], text);
+		}
+	}
+	void draw(const Canvas& canvas) const override {
+		int16_t y{bounds().y0};
+		for (size_t i = 0; i < line_count; i++) {
+			canvas.draw_text(_lines[i], bounds().x0, y, _color);
+			y += _line_height;
+		}
+	}
+private:
+	int16_t _line_height;
+	color_t _color;
+	char _lines[line_count][UI_TEXT_LENGTH]{};
+};
+
+// A static prefix followed by a value with a fixed number of decimals.
+class NumericReadout : public Widget {
+public:
+	NumericReadout(int16_t x, int16_t y, int16_t width, color_t color, const char* prefix, uint8_t precision)
+		: Widget(Rect{x, y, static_cast<int16_t>(x + width - 1), static_cast<int16_t>(y + UI_GLYPH_HEIGHT - 1)})
+		, _color{color}
+		, _prefix{prefix}
+		, _precision{precision}
+	{
+		set_value(0.0F);
+	}
+	// Only marks the widget dirty when the formatted text changes.
+	void set_value(float value) {
+		char text[UI_TEXT_LENGTH]{};
+		format_decimal(text, sizeof(text), value, _precision);
+		set_text(_text, text);
+	}
+	void draw(const Canvas& canvas) const override {
+		const int16_t prefix_width{canvas.draw_static_text(_prefix, bounds().x0, bounds().y0, _color)};
+		canvas.draw_text(_text, bounds().x0 + prefix_width, bounds().y0, _color);
+	}
+private:
+	color_t _color;
+	const char* _prefix;
+	uint8_t _precision;
+	char _text[UI_TEXT_LENGTH]{};
+};
+
+/*
+Owns the widget list and the link between the hagl back buffer and the
+display. render() clears and redraws only the dirty widgets, then sends
+the full width row bands they cover, rows are contiguous in the back
+buffer so each band is one mipi_display_write().
+*/
+template<size_t max_widgets>
+class Screen {
+public:
+	Screen(bitmap_t* framebuffer, TextCache* text_cache, color_t background)
+		: _framebuffer{framebuffer}
+		, _canvas{framebuffer, text_cache}
+		, _background{background}
+	{}
+	~Screen()=default;
+
+	Screen(const Screen&)=delete;
+	Screen(const Screen&&)=delete;
+	Screen& operator=(const Screen&)=delete;
+	Screen& operator=(const Screen&&)=delete;
+
+	bool add(Widget* widget) {
+		if (_widget_count == max_widgets) {
+			return false;
+		}
+		_widgets[_widget_count] = widget;
+		_widget_count++;
+		widget->mark_dirty();
+		return true;
+	}
+	void invalidate() {
+		for (size_t i = 0; i < _widget_count; i++) {
+			_widgets[i]->mark_dirty();
+		}
+	}
+	// nullptr draws static text uncached, everything is redrawn either way
+	void set_text_cache(TextCache* text_cache) {
+		_canvas.set_text_cache(text_cache);
+		invalidate();
+	}
+
+	// Returns the number of bytes sent to the display.
+	size_t render() {
+		const uint32_t draw_start{time_us_32()};
+		for (size_t i = 0; i < _widget_count; i++) {
+			Widget* widget{_widgets[i]};
+			if (!widget->dirty()) {
+				continue;
+			}
+			const Rect& area{widget->bounds()};
+			hagl_fill_rectangle(area.x0, area.y0, area.x1, area.y1, _background);
+			widget->draw(_canvas);
+			widget->clear_dirty();
+			mark_rows(area.y0, area.y1);
+		}
+		const uint32_t flush_start{time_us_32()};
+		const size_t bytes{flush_dirty_rows()};
+		if (bytes > 0) {
+			_timing = RenderTiming{flush_start - draw_start, time_us_32() - flush_start};
+		}
+		return bytes;
+	}
+	const RenderTiming& last_timing() const {
+		return _timing;
+	}
+private:
+	void mark_rows(int16_t y0, int16_t y1) {
+		for (int32_t y = y0 < 0 ? 0 : y0; y <= y1 && y < DISPLAY_HEIGHT; y++) {
+			_dirty_rows[y / 32] |= 1U << (y % 32);
+		}
+	}
+	bool row_dirty(int32_t y) const {
+		return (_dirty_rows[y / 32] & (1U << (y % 32))) != 0U;
+	}
+	size_t flush_dirty_rows() {
+		size_t bytes{0};
+		int32_t y{0};
+		while (y < DISPLAY_HEIGHT) {
+			if (!row_dirty(y)) {
+				y++;
+				continue;
+			}
+			const int32_t first{y};
+			while (y < DISPLAY_HEIGHT && row_dirty(y)) {
+				y++;
+			}
+			bytes += mipi_display_write(
+				0,
+				static_cast<uint16_t>(first),
+				_framebuffer->width,
+				static_cast<uint16_t>(y - first),
+				_framebuffer->buffer + first * _framebuffer->pitch);
+		}
+		_dirty_rows = {};
+		return bytes;
+	}
+
+	bitmap_t* _framebuffer;
+	Canvas _canvas;
+	color_t _background;
+
+	std::array<Widget*, max_widgets> _widgets{};
+	size_t _widget_count{0};
+	std::array<uint32_t, (DISPLAY_HEIGHT + 31) / 32> _dirty_rows{};
+	RenderTiming _timing{};
+};
+
+#endif
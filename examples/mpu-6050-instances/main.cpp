@@ -0,0 +1,246 @@
+// File: main.cpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+/*
+Stress test for the instance tables shared by the gpio irq and both cores.
+
+core1 plays the gpio irq, calling the dispatcher for the devices' pins,
+while core0 registers, unregisters and takes the ready mask. One MPU-6050
+is needed, every instance talks to it, only the first interrupt pin has to
+be wired and its irq is turned off for the test.
+
+phase 1: core0 registers and unregisters at random, ready bits must only
+         ever belong to registered instances and the tables must agree.
+phase 2: every instance stays registered, core1 raises one interrupt per
+         instance at a time and waits for core0 to see it. A raise that
+         is never seen is a ready bit lost to a racing update.
+*/
+
+#include <array>
+
+#include "pico/stdlib.h"
+#include "pico/binary_info.h"
+#include "pico/multicore.h"
+
+#include "mpu6050.hpp"
+#include "mpu6050_config.hpp"
+
+// next_random()
+#include "benchmark.hpp"
+
+constexpr size_t DEVICE_COUNT{MAX_INSTANCES};
+constexpr std::array<uint8_t, 4> INTERRUPT_PINS{8, 10, 11, 12};
+static_assert(DEVICE_COUNT <= INTERRUPT_PINS.size(), "one interrupt pin per instance");
+
+constexpr uint32_t REGISTER_ROUNDS{200000};
+constexpr uint32_t HANDSHAKE_ROUNDS{200000};
+constexpr uint32_t LOST_TIMEOUT_US{100000};
+
+constexpr uint32_t CORE1_READY{1};
+
+// the driver's gpio irq dispatcher, called directly to stand in for the irq
+void mpu6050_gpio_callback(uint gpio, uint32_t events);
+
+// core0 -> core1, which phase to run, 0 stops it
+static volatile uint32_t phase{0};
+// phase 2 handshake, core1 bumps raised[i] before raising, core0 copies it to acked[i]
+static volatile uint32_t raised[DEVICE_COUNT]{};
+static volatile uint32_t acked[DEVICE_COUNT]{};
+
+void core1_entry() {
+	multicore_fifo_push_blocking(CORE1_READY);
+	uint32_t random{0x9E3779B9};
+	while (true) {
+		const uint32_t current{phase};
+		if (current == 1) {
+			const uint8_t pin{INTERRUPT_PINS[next_random(random) % DEVICE_COUNT]};
+			mpu6050_gpio_callback(pin, GPIO_IRQ_EDGE_RISE);
+		} else if (current == 2) {
+			const size_t i{next_random(random) % DEVICE_COUNT};
+			if (acked[i] == raised[i]) {
+				raised[i] = raised[i] + 1;
+				mpu6050_gpio_callback(INTERRUPT_PINS[i], GPIO_IRQ_EDGE_RISE);
+			}
+		}
+	}
+}
+
+static bool tables_agree(const std::array<MPU6050*, DEVICE_COUNT> &devices, uint32_t registered) {
+	size_t count{0};
+	for (size_t i = 0; i < DEVICE_COUNT; i++) {
+		MPU6050* mpu{devices[i]};
+		const bool is_registered{(registered & (1U << i)) != 0U};
+		if (is_registered != (MPU6050::pin_instances[INTERRUPT_PINS[i]] == mpu)) {
+			return false;
+		}
+		if (is_registered) {
+			if (mpu->instance_id() >= MAX_INSTANCES || MPU6050::instances[mpu->instance_id()] != mpu) {
+				return false;
+			}
+			count++;
+		} else if (mpu->instance_id() != INVALID_INSTANCE_ID) {
+			return false;
+		}
+	}
+	return count == MPU6050::instance_count();
+}
+static uint32_t registered_ids(const std::array<MPU6050*, DEVICE_COUNT> &devices, uint32_t registered) {
+	uint32_t ids{0};
+	for (size_t i = 0; i < DEVICE_COUNT; i++) {
+		if ((registered & (1U << i)) != 0U) {
+			ids |= 1U << devices[i]->instance_id();
+		}
+	}
+	return ids;
+}
+
+static bool run_register_phase(const std::array<MPU6050*, DEVICE_COUNT> &devices) {
+	uint32_t registered{(1U << DEVICE_COUNT) - 1U};
+	uint32_t random{0x2545F491};
+	uint32_t stray_bits{0};
+	uint32_t failures{0};
+
+	MPU6050::take_ready_instances();
+	phase = 1;
+	for (uint32_t round = 0; round < REGISTER_ROUNDS; round++) {
+		const size_t i{next_random(random) % DEVICE_COUNT};
+		const uint32_t bit{1U << i};
+		if ((registered & bit) != 0U) {
+			MPU6050::unregister_instance(devices[i]);
+			registered &= ~bit;
+		} else if (MPU6050::register_instance(devices[i])) {
+			registered |= bit;
+		} else {
+			failures++;
+		}
+
+		const uint32_t ready{MPU6050::take_ready_instances()};
+		if ((ready & ~registered_ids(devices, registered)) != 0U) {
+			stray_bits++;
+		}
+		if (!tables_agree(devices, registered)) {
+			failures++;
+		}
+	}
+	phase = 0;
+	// let core1 finish the call it is in
+	sleep_ms(1);
+
+	// leave everything registered for the next phase
+	for (size_t i = 0; i < DEVICE_COUNT; i++) {
+		if ((registered & (1U << i)) == 0U && !MPU6050::register_instance(devices[i])) {
+			failures++;
+		}
+	}
+	printf("register/unregister: %lu rounds, %lu stray ready bits, %lu failures\n",
+		REGISTER_ROUNDS, stray_bits, failures);
+	return stray_bits == 0 && failures == 0;
+}
+
+static bool run_handshake_phase(const std::array<MPU6050*, DEVICE_COUNT> &devices) {
+	uint32_t seen{0};
+	uint32_t spurious{0};
+	uint32_t lost{0};
+
+	MPU6050::take_ready_instances();
+	for (size_t i = 0; i < DEVICE_COUNT; i++) {
+		acked[i] = 0;
+		raised[i] = 0;
+	}
+	phase = 2;
+	absolute_time_t timeout{make_timeout_time_us(LOST_TIMEOUT_US)};
+	while (seen < HANDSHAKE_ROUNDS) {
+		const uint32_t ready{MPU6050::take_ready_instances()};
+		for (size_t i = 0; i < DEVICE_COUNT; i++) {
+			if ((ready & (1U << devices[i]->instance_id())) == 0U) {
+				continue;
+			}
+			if (acked[i] == raised[i]) {
+				spurious++;
+			} else {
+				acked[i] = raised[i];
+				seen++;
+			}
+		}
+		if (ready != 0U) {
+			timeout = make_timeout_time_us(LOST_TIMEOUT_US);
+		} else if (time_reached(timeout)) {
+			// core1 is stuck waiting on raises core0 never saw, release them
+			for (size_t i = 0; i < DEVICE_COUNT; i++) {
+				if (acked[i] != raised[i]) {
+					acked[i] = raised[i];
+					lost++;
+				}
+			}
+			timeout = make_timeout_time_us(LOST_TIMEOUT_US);
+		}
+	}
+	phase = 0;
+	// let core1 finish the call it is in
+	sleep_ms(1);
+	printf("ready handshake: %lu seen, %lu lost, %lu spurious\n", seen, lost, spurious);
+	return lost == 0 && spurious == 0;
+}
+
+int main() {
+	stdio_init_all();
+	printf("Starting up MPU-6050 instance stress test.\n");
+
+	bi_decl(bi_program_name("mpu_6050_instances_example"));
+	bi_decl(bi_program_description("Stresses the MPU-6050 instance tables from both cores."));
+	bi_decl(bi_program_version_string("1.0.0"));
+	bi_decl(bi_program_url("https://github.com/jacobguenther/pico-libs"));
+	bi_decl(bi_program_feature("License AGPLv3"));
+
+	const uint8_t mpu_power_pin{9};
+	gpio_init(mpu_power_pin);
+	gpio_set_dir(mpu_power_pin, GPIO_OUT);
+	gpio_put(mpu_power_pin, 1);
+
+	bi_decl(bi_1pin_with_name(mpu_power_pin, "MPU-6050 POWER"));
+
+	const uint8_t sda_pin{16};
+	const uint8_t scl_pin{17};
+	const uint32_t i2c_baudrate{400000}; // Hz
+
+	bi_decl(bi_2pins_with_func(sda_pin, scl_pin, GPIO_FUNC_I2C));
+
+	i2c_init(i2c0, i2c_baudrate);
+	gpio_set_function(sda_pin, GPIO_FUNC_I2C);
+	gpio_set_function(scl_pin, GPIO_FUNC_I2C);
+	gpio_pull_up(sda_pin);
+	gpio_pull_up(scl_pin);
+
+	bi_decl(bi_1pin_with_name(INTERRUPT_PINS[0], "MPU-6050 IRQ"));
+
+	const auto dlpf = DLPF_CONFIG::DLPF_CFG_BANDWIDTH_94_Hz;
+	const auto accel_fs = ACCEL_CONFIG::FS_SELECT_16_G_BIT;
+	const auto gyro_fs = GYRO_CONFIG::FS_SELECT_250_DEG_PER_SEC_BIT;
+	const uint32_t mpu_sample_rate{100}; // Hz
+
+	static std::array<MPU6050*, DEVICE_COUNT> devices{};
+	for (size_t i = 0; i < DEVICE_COUNT; i++) {
+		devices[i] = new MPU6050(i2c0, MPU6050Address::DEFAULT, INTERRUPT_PINS[i],
+			mpu_sample_rate, dlpf, accel_fs, gyro_fs);
+		if (!devices[i]->ok()) {
+			printf("Failed to start instance %u\n", static_cast<unsigned>(i));
+			return 1;
+		}
+		// only core1 raises interrupts from here on
+		devices[i]->deinit_pin_interrupt();
+	}
+
+	multicore_launch_core1(core1_entry);
+	multicore_fifo_pop_blocking();
+
+	uint32_t pass{0};
+	while (true) {
+		const bool tables_ok{run_register_phase(devices)};
+		const bool ready_ok{run_handshake_phase(devices)};
+		pass++;
+		printf("pass %lu: %s\n", pass, tables_ok && ready_ok ? "ok" : "FAILED");
+		sleep_ms(1000);
+	}
+}
@@ -12,6 +12,7 @@
 #include "mpu6050_config.hpp"
 #include "median_filter.hpp"
 #include "complementary_filter.hpp"
+#include "number_format.hpp"
 
 extern "C" {
 	#include "pico_servo.h"
@@ -82,10 +83,12 @@ int main() {
 		accel_fs,
 		gyro_fs
 	);
+	if (!mpu0.ok()) {
+		printf("Failed to start the MPU-6050.\n");
+		return 1;
+	}
 
-	MedianFilter<mean_filter_size> accel_x_filter;
-	MedianFilter<mean_filter_size> accel_y_filter;
-	MedianFilter<mean_filter_size> accel_z_filter;
+	MedianFilter3<mean_filter_size> accel_filter;
 	ComplementaryFilter comp_filter = ComplementaryFilter(dt, gyro_bias);
 
 	float pitch{0.0F};
@@ -99,18 +102,17 @@ int main() {
 			mpu0.read_data_from_device();
 
 			auto [accel, gyro] = mpu0.get_offset_accel_and_scaled_gyros();
-			accel_x_filter.update(accel[0]);
-			accel_y_filter.update(accel[1]);
-			accel_z_filter.update(accel[2]);
-			std::array<int16_t, 3> filtered_accel = {
-				accel_x_filter.get_median(),
-				accel_y_filter.get_median(),
-				accel_z_filter.get_median()
-			};
+			accel_filter.update(accel);
+			const std::array<int16_t, 3> filtered_accel{accel_filter.get_median()};
 			comp_filter.update(filtered_accel, gyro);
 			std::tie(pitch, roll) = comp_filter.get_filtered_angles();
 
-			printf("pitch: %.2f roll: %.2f\n", pitch, roll);
+			// formatted without printf's float code
+			std::array<char, MAX_FORMAT_LENGTH + 1> pitch_text{};
+			std::array<char, MAX_FORMAT_LENGTH + 1> roll_text{};
+			format_decimal(pitch_text.data(), pitch_text.size(), pitch, 2);
+			format_decimal(roll_text.data(), roll_text.size(), roll, 2);
+			printf("pitch: %s roll: %s\n", pitch_text.data(), roll_text.data());
 		}
 
 		servo_move_to(pitch_servo_pin, pitch + 90.0F);
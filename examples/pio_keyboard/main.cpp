@@ -23,7 +23,13 @@ int main() {
 	bi_decl(bi_program_url("https://github.com/jacobguenther/pico-libs"));
 	bi_decl(bi_program_feature("License AGPLv3"));
 
-	auto pio_keyboard = PIOKeyboard<ROW_COUNT, COL_COUNT>(FIRAT_ROW_PIN, FIRST_COL_PIN, pio0);
+	// a DMA channel empties the RX FIFO so the scan never stalls
+	static auto pio_keyboard = PIOKeyboard<ROW_COUNT, COL_COUNT>(FIRAT_ROW_PIN, FIRST_COL_PIN, pio0, PIOKeyboardMode::DMA);
+	if (!pio_keyboard.ok()) {
+		printf("Failed to start the PIO keyboard.\n");
+	} else if (pio_keyboard.mode() != PIOKeyboardMode::DMA) {
+		printf("Not enough free DMA channels, polling the PIO keyboard's FIFOs instead.\n");
+	}
 
 	printf("Entering main loop.\n");
 
@@ -32,6 +38,10 @@ int main() {
 			pio_keyboard.poll_buttons();
 			pio_keyboard.print_key_events();
 			pio_keyboard.clear_events();
+			printf("states: %lu dropped: %lu rx stalls: %lu\n",
+				static_cast<unsigned long>(pio_keyboard.states_processed()),
+				static_cast<unsigned long>(pio_keyboard.states_dropped()),
+				static_cast<unsigned long>(pio_keyboard.rx_stall_count()));
 		}
 	}
 
@@ -0,0 +1,145 @@
+// File: spsc_ring.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <array>   // array
+#include <atomic>  // atomic
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
+
+// Contiguous run of queued values, valid until they are consumed.
+template<typename T>
+struct RingSpan {
+	const T* data;
+	size_t count;
+
+	const T* begin() const {
+		return data;
+	}
+	const T* end() const {
+		return data + count;
+	}
+	size_t size() const {
+		return count;
+	}
+	bool empty() const {
+		return count == 0;
+	}
+};
+
+/*
+Single producer, single consumer ring, e.g. an interrupt handler filling it
+and the main loop draining it. Only atomic loads and stores are used, the
+M0+ has no read-modify-write atomics.
+
+When full, push() drops the new value and counts an overrun, values already
+queued are never overwritten.
+
+Reading in batches:
+	RingSpan<T> values{ring.peek()};
+	for (const T& value : values) { ... }
+	ring.consume(values.size());
+peek() stops at the end of the buffer, a wrapped ring takes two batches.
+
+Invariants: capacity is a power of two
+*/
+template<typename T, size_t capacity>
+class SpscRing {
+public:
+	SpscRing() {
+		static_assert(capacity != 0 && (capacity & (capacity - 1)) == 0, "the capacity must be a power of two");
+	}
+	~SpscRing()=default;
+
+	SpscRing(const SpscRing&)=delete;
+	SpscRing(const SpscRing&&)=delete;
+	SpscRing& operator=(const SpscRing&)=delete;
+	SpscRing& operator=(const SpscRing&&)=delete;
+
+	// producer
+	bool push(const T &value) {
+		const uint32_t head{_head.load(std::memory_order_relaxed)};
+		const uint32_t tail{_tail.load(std::memory_order_acquire)};
+		if (head - tail == capacity) {
+			_overrun_count.store(_overrun_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return false;
+		}
+		_items[head & MASK] = value;
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer
+	bool pop(T* value) {
+		const uint32_t tail{_tail.load(std::memory_order_relaxed)};
+		const uint32_t head{_head.load(std::memory_order_acquire)};
+		if (head == tail) {
+			return false;
+		}
+		*value = _items[tail & MASK];
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+	RingSpan<T> peek() const {
+		const uint32_t tail{_tail.load(std::memory_order_relaxed)};
+		const uint32_t head{_head.load(std::memory_order_acquire)};
+		const uint32_t until_wrap{static_cast<uint32_t>(capacity) - (tail & MASK)};
+		const uint32_t pending{head - tail};
+		return RingSpan<T>{&_items[tail & MASK], pending < until_wrap ? pending : until_wrap};
+	}
+	void consume(size_t count) {
+		const uint32_t tail{_tail.load(std::memory_order_relaxed)};
+		const uint32_t pending{_head.load(std::memory_order_acquire) - tail};
+		const uint32_t consumed{count < pending ? static_cast<uint32_t>(count) : pending};
+		_tail.store(tail + consumed, std::memory_order_release);
+	}
+	// Calls f(value) for everything queued when the drain started, oldest
+	// first. Returns the number of values passed to f.
+	template<typename F>
+	size_t drain(F&& f) {
+		uint32_t tail{_tail.load(std::memory_order_relaxed)};
+		const uint32_t head{_head.load(std::memory_order_acquire)};
+		const size_t count{head - tail};
+		while (tail != head) {
+			f(static_cast<const T&>(_items[tail & MASK]));
+			tail++;
+			_tail.store(tail, std::memory_order_release);
+		}
+		return count;
+	}
+	// Like drain() without consuming.
+	template<typename F>
+	void for_each(F&& f) const {
+		const uint32_t head{_head.load(std::memory_order_acquire)};
+		for (uint32_t i = _tail.load(std::memory_order_relaxed); i != head; i++) {
+			f(static_cast<const T&>(_items[i & MASK]));
+		}
+	}
+	void clear() {
+		_tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+	size_t size() const {
+		return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+	}
+	bool empty() const {
+		return size() == 0;
+	}
+	uint32_t overrun_count() const {
+		return _overrun_count.load(std::memory_order_relaxed);
+	}
+private:
+	static constexpr uint32_t MASK{static_cast<uint32_t>(capacity - 1)};
+
+	std::array<T, capacity> _items{};
+	std::atomic<uint32_t> _head{0};
+	std::atomic<uint32_t> _tail{0};
+	// written by the producer only
+	std::atomic<uint32_t> _overrun_count{0};
+};
+
+#endif
@@ -0,0 +1,73 @@
+// File: key_bitmap.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef KEY_BITMAP_HPP
+#define KEY_BITMAP_HPP
+
+#include <array>   // array
+#include <cstddef> // size_t
+#include <cstdint> // uint8_t, uint32_t
+
+constexpr size_t KEY_BITMAP_WORD_BITS{32};
+
+constexpr size_t key_bitmap_words(size_t key_count) {
+	return (key_count + KEY_BITMAP_WORD_BITS - 1) / KEY_BITMAP_WORD_BITS;
+}
+// The low bit_count bits set, bit_count up to 32.
+constexpr uint32_t low_bits_mask(size_t bit_count) {
+	return bit_count >= KEY_BITMAP_WORD_BITS ? 0xFFFFFFFFU : (1U << bit_count) - 1U;
+}
+
+/*
+Calls f(bit, is_down) for each bit that differs between previous and
+current, lowest first. Only the changed bits are visited, so a scan with
+nothing changed costs one compare however large the matrix is.
+
+The M0+ has no count trailing zeros instruction, __builtin_ctz becomes a
+short libgcc routine. That is still cheaper than testing all 32 bits once
+fewer than a handful changed, which is nearly every scan.
+*/
+template<typename F>
+inline void for_each_changed_bit(uint32_t previous, uint32_t current, F&& f) {
+	uint32_t changed{previous ^ current};
+	while (changed != 0U) {
+		const uint8_t bit{static_cast<uint8_t>(__builtin_ctz(changed))};
+		f(bit, (current & (1U << bit)) != 0U);
+		// clear the lowest set bit
+		changed &= changed - 1U;
+	}
+}
+
+// for_each_changed_bit() over every word, bits are numbered across words.
+template<size_t word_count, typename F>
+inline void for_each_changed_key(
+	const std::array<uint32_t, word_count> &previous,
+	const std::array<uint32_t, word_count> &current,
+	F&& f)
+{
+	for (size_t word = 0; word < word_count; word++) {
+		const size_t first_key{word * KEY_BITMAP_WORD_BITS};
+		for_each_changed_bit(previous[word], current[word], [&f, first_key](uint8_t bit, bool is_down) {
+			f(static_cast<uint8_t>(first_key + bit), is_down);
+		});
+	}
+}
+
+// Writes the low bit_count bits of value starting at first_bit, which may
+// straddle two words. Bits outside the range are left alone.
+template<size_t word_count>
+inline void write_key_bits(std::array<uint32_t, word_count> &bitmap, size_t first_bit, size_t bit_count, uint32_t value) {
+	const size_t word{first_bit / KEY_BITMAP_WORD_BITS};
+	const size_t shift{first_bit % KEY_BITMAP_WORD_BITS};
+	const uint32_t mask{low_bits_mask(bit_count)};
+	value &= mask;
+	bitmap[word] = (bitmap[word] & ~(mask << shift)) | (value << shift);
+	if (shift != 0 && shift + bit_count > KEY_BITMAP_WORD_BITS) {
+		const size_t spilled{KEY_BITMAP_WORD_BITS - shift};
+		bitmap[word + 1] = (bitmap[word + 1] & ~(mask >> spilled)) | (value >> spilled);
+	}
+}
+
+#endif
@@ -0,0 +1,25 @@
+// File: key_event_queue.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef KEY_EVENT_QUEUE_HPP
+#define KEY_EVENT_QUEUE_HPP
+
+#include <cstddef> // size_t
+
+#include "key_event.hpp"
+#include "spsc_ring.hpp"
+
+#ifndef KEY_EVENT_QUEUE_CAPACITY
+#define KEY_EVENT_QUEUE_CAPACITY 32
+#endif
+
+using KeyEventSpan = RingSpan<KeyEvent>;
+
+// Key event ring with one producer, the scan, which may run in an
+// interrupt, and one consumer, the main loop.
+template<size_t capacity>
+using KeyEventQueue = SpscRing<KeyEvent, capacity>;
+
+#endif
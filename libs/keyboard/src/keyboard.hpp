@@ -11,7 +11,14 @@
 
 #include "pico/stdlib.h"
 
+#include "key_bitmap.hpp"
 #include "key_event.hpp"
+#include "key_event_queue.hpp"
+
+// Time for a row to settle after its column is driven low. The old per
+// pin loop got this for free between reads, one gpio_get_all() right
+// after gpio_put() can see the rows still pulled up.
+constexpr uint32_t KEYBOARD_SETTLE_US{2};
 
 bool keyboard_callback(repeating_timer *keyboard_timer) {
 	auto keyboard_available{static_cast<bool*>(keyboard_timer->user_data)};
@@ -23,6 +30,9 @@ bool keyboard_callback(repeating_timer *keyboard_timer) {
 template<uint8_t row_count, uint8_t col_count>
 class Keyboard {
 public:
+	static constexpr size_t KEY_COUNT{static_cast<size_t>(row_count) * col_count};
+	static constexpr size_t KEY_BITMAP_WORDS{key_bitmap_words(KEY_COUNT)};
+
 	Keyboard(
 		uint8_t first_row_pin,
 		uint8_t first_col_pin
@@ -30,6 +40,9 @@ public:
 		: _first_row_pin{first_row_pin}
 		, _first_col_pin{first_col_pin}
 	{
+		static_assert(KEY_COUNT <= 0xFF, "key indices must fit in a uint8_t");
+		static_assert(row_count <= KEY_BITMAP_WORD_BITS, "the rows are read in one gpio_get_all()");
+
 		const auto create_timer_success = add_repeating_timer_ms(
 			_poll_rate_ms,
 			keyboard_callback,
@@ -38,10 +51,6 @@ public:
 		if (!create_timer_success) {
 			printf("Failed to create keyboard callback");
 		}
-		
-		for (uint8_t key = 0; key < KEY_COUNT; key++) {
-			_keys_pressed[key] = false;
-		}
 
 		for (uint8_t row = 0; row < row_count; row++) {
 			const uint8_t row_pin = _first_row_pin + row;
@@ -62,31 +71,36 @@ public:
 		return _available;
 	}
 
+	// Reads every row at once per column, then reports only the keys that
+	// changed since the last poll.
 	void poll_buttons() {
-		uint8_t key_index = 0;
+		std::array<uint32_t, KEY_BITMAP_WORDS> current{};
 		for (uint8_t col = 0, col_pin = _first_col_pin; col < col_count; col++, col_pin++) {
 			gpio_put(col_pin, false);
-
-			for (uint8_t row = 0, row_pin = _first_row_pin; row < row_count; row++, row_pin++) {
-				const bool previous_state{_keys_pressed[key_index]};
-				const bool is_down{!gpio_get(row_pin)};
-				_keys_pressed[key_index] = is_down;
-				
-				if (is_down != previous_state) {
-					const auto event_type = static_cast<KeyEventE>(KeyEventE::KEY_UP - static_cast<int>(is_down));
-					_key_events[_key_event_count] = KeyEvent {event_type, key_index};
-					_key_event_count++;
-				}
-
-				key_index++;
-			}
-
+			busy_wait_us_32(KEYBOARD_SETTLE_US);
+			const uint32_t pins{gpio_get_all()};
 			gpio_put(col_pin, true);
+
+			// rows are active low
+			write_key_bits(current, static_cast<size_t>(col) * row_count, row_count, ~pins >> _first_row_pin);
 		}
+
+		for_each_changed_key(_key_bitmap, current, [this](uint8_t key_index, bool is_down) {
+			const auto event_type = static_cast<KeyEventE>(KeyEventE::KEY_UP - static_cast<int>(is_down));
+			_key_events.push(KeyEvent {event_type, key_index});
+		});
+		_key_bitmap = current;
+	}
+
+	bool is_pressed(uint8_t key_index) const {
+		return key_index < KEY_COUNT && (_key_bitmap[key_index / KEY_BITMAP_WORD_BITS] & (1U << (key_index % KEY_BITMAP_WORD_BITS))) != 0U;
+	}
+	// bit key_index % 32 of word key_index / 32 is set while the key is down
+	const std::array<uint32_t, KEY_BITMAP_WORDS>& key_bitmap() const {
+		return _key_bitmap;
 	}
 	void print_key_events() const {
-		for (uint8_t i = 0; i < _key_event_count; i++) {
-			const KeyEvent event{_key_events[i]};
+		_key_events.for_each([](const KeyEvent& event) {
 			switch (event.event_type) {
 				case KeyEventE::KEY_DOWN:
 					printf("down");
@@ -96,10 +110,28 @@ public:
 					break;
 			}
 			printf(" %i\n", event.key_index);
-		}
+		});
+	}
+	// Events queue until the consumer takes them, see KeyEventQueue.
+	KeyEventSpan peek_events() const {
+		return _key_events.peek();
+	}
+	void consume_events(size_t count) {
+		_key_events.consume(count);
+	}
+	template<typename F>
+	size_t drain_events(F&& f) {
+		return _key_events.drain(f);
+	}
+	size_t events_pending() const {
+		return _key_events.size();
+	}
+	// events dropped because the queue was full
+	uint32_t event_overrun_count() const {
+		return _key_events.overrun_count();
 	}
 	void clear_events() {
-		_key_event_count = 0;
+		_key_events.clear();
 	}
 private:
 	int32_t _poll_rate_ms{-1};
@@ -109,11 +141,9 @@ private:
 	uint8_t _first_row_pin;
 	uint8_t _first_col_pin;
 
-	const static uint8_t KEY_COUNT{row_count * col_count};
-	std::array<bool, KEY_COUNT> _keys_pressed{};
+	std::array<uint32_t, KEY_BITMAP_WORDS> _key_bitmap{};
 
-	uint8_t _key_event_count{0};
-	std::array<KeyEvent, KEY_COUNT> _key_events{};
+	KeyEventQueue<KEY_EVENT_QUEUE_CAPACITY> _key_events;
 };
 
 #endif
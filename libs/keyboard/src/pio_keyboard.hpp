@@ -6,65 +6,171 @@
 #ifndef PIO_KEYBOARD_HPP
 #define PIO_KEYBOARD_HPP
 
+#include <array>
 #include <cstdio>
 
-#include <vector>
-
 #include "pico/stdlib.h"
+#include "hardware/dma.h"
 #include "hardware/pio.h"
 
+#include "key_bitmap.hpp"
 #include "key_event.hpp"
-#include "keyboard_program.pio.h"
+#include "key_event_queue.hpp"
+#include "pio_scan_program.hpp"
+
+// Words, a power of two. The ring is aligned to its size for DMA wrapping.
+constexpr uint32_t PIO_KEYBOARD_STATE_RING_SIZE{64};
+constexpr uint32_t PIO_KEYBOARD_STATE_RING_BITS{8}; // log2 of the size in bytes
+
+// Most keys one state machine reads, one pushed word.
+constexpr uint32_t PIO_KEYBOARD_KEYS_PER_MACHINE{32};
+
+enum class PIOKeyboardMode {
+	// poll_buttons() reads the RX FIFO, a slow loop stalls the scan once
+	// 8 states are waiting
+	POLLED,
+	// a DMA channel per state machine empties the RX FIFO into a RAM ring
+	// as states are pushed, poll_buttons() handles everything in the rings
+	DMA,
+};
 
+/*
+Scans a key matrix on one PIO block. Keys are numbered col * row_count +
+row like Keyboard, is_pressed() and key_bitmap() give the current state.
+
+Matrices with more than 32 keys are split into row groups, each read by
+its own state machine. All of them run the same program in lockstep, only
+the first drives the columns. Up to 4 machines, so 128 keys, and the
+longer side of the matrix should be on the rows: 18 rows x 6 columns
+needs 4 machines, 6 rows x 18 columns would need 6.
+*/
 template<uint8_t row_count, uint8_t col_count>
 class PIOKeyboard {
 public:
+	static constexpr size_t KEY_COUNT{static_cast<size_t>(row_count) * col_count};
+	static constexpr size_t KEY_BITMAP_WORDS{key_bitmap_words(KEY_COUNT)};
+
 	PIOKeyboard(
 		uint8_t first_row_pin,
 		uint8_t first_col_pin,
-		PIO pio
+		PIO pio,
+		PIOKeyboardMode mode = PIOKeyboardMode::POLLED
 	)
 		: _first_row_pin{first_row_pin}
 		, _first_col_pin{first_col_pin}
 		, _pio{pio}
+		, _mode{mode}
 	{
-		assert(row_count <= 30 - 5);
-		assert(col_count <= 5);
-		_key_events.reserve(KEY_COUNT);
+		static_assert(sizeof(_state_rings[0]) == 1U << PIO_KEYBOARD_STATE_RING_BITS, "the ring bits must match the ring size");
+		static_assert(col_count <= PIO_KEYBOARD_KEYS_PER_MACHINE, "one column of every row group must fit in one pushed word");
+		static_assert(MACHINE_COUNT <= NUM_PIO_STATE_MACHINES, "too many row groups for one PIO block, put the longer side on the rows");
+		static_assert(SCAN_PROGRAM.length <= PIO_INSTRUCTION_MEMORY_SIZE, "the scan program must fit in instruction memory");
 
-		uint32_t offset{0};
-		if (pio_can_add_program(_pio, &keyboard_program)) {
-			offset = pio_add_program(_pio, &keyboard_program);
+		if (!pio_can_add_program(_pio, &_program)) {
+			return;
+		}
+		_program_offset = pio_add_program(_pio, &_program);
+		if (!claim_state_machines()) {
+			pio_remove_program(_pio, &_program, _program_offset);
+			return;
 		}
-		keyboard_program_init(_pio, _state_machine, offset, _first_col_pin, col_count, _first_row_pin, row_count);
-		pio_sm_set_enabled(_pio, _state_machine, true);
+		_program_loaded = true;
+		init_state_machines();
+		if (_mode == PIOKeyboardMode::DMA && !start_dma()) {
+			_mode = PIOKeyboardMode::POLLED;
+		}
+		// restarts the clock dividers together so the machines stay in lockstep
+		pio_enable_sm_mask_in_sync(_pio, _machine_mask);
 	}
+	~PIOKeyboard() {
+		if (!_program_loaded) {
+			return;
+		}
+		pio_set_sm_mask_enabled(_pio, _machine_mask, false);
+		if (_mode == PIOKeyboardMode::DMA) {
+			for (const ScanMachine& machine : _machines) {
+				dma_channel_abort(machine.dma_channel);
+				dma_channel_unclaim(machine.dma_channel);
+			}
+		}
+		for (const ScanMachine& machine : _machines) {
+			pio_sm_unclaim(_pio, machine.state_machine);
+		}
+		pio_remove_program(_pio, &_program, _program_offset);
+	}
+
+	// the DMA channel writes into this object
+	PIOKeyboard(const PIOKeyboard&)=delete;
+	PIOKeyboard(PIOKeyboard&&)=delete;
+	PIOKeyboard& operator=(const PIOKeyboard&)=delete;
+	PIOKeyboard& operator=(PIOKeyboard&&)=delete;
 
-	bool available() {
-		return !pio_sm_is_rx_fifo_empty(_pio, _state_machine);
+	// False when the scan program or its state machines did not fit, the
+	// keyboard never scans then. Check it after construction.
+	bool ok() const {
+		return _program_loaded;
+	}
+	// POLLED when DMA was asked for but no channels were free
+	PIOKeyboardMode mode() const {
+		return _mode;
+	}
+	bool available() const {
+		if (!_program_loaded) {
+			return false;
+		}
+		for (const ScanMachine& machine : _machines) {
+			if (_mode == PIOKeyboardMode::DMA
+				? dma_states_written(machine) != machine.states_read
+				: !pio_sm_is_rx_fifo_empty(_pio, machine.state_machine))
+			{
+				return true;
+			}
+		}
+		return false;
 	}
+	// Handles every state pushed since the last call, oldest first within
+	// each row group.
 	void poll_buttons() {
-		// std::vec<uint32_t> states;
-		// while available() {
-		// 	states = ~pio_sm_get(_pio, _state_machine);
-		// }
-		const uint32_t current_state{~pio_sm_get(_pio, _state_machine)};
-		if (_previous_state != current_state) {
-			for (uint8_t key_num = 0; key_num < KEY_COUNT; key_num++) {
-				const uint32_t mask{1U << key_num};
-				const bool is_pressed{(current_state & mask) != 0U};
-				const bool was_pressed{(_previous_state & mask) != 0U};
-				if (is_pressed != was_pressed) {
-					const auto event_type = static_cast<KeyEventE>(KeyEventE::KEY_UP - static_cast<int>(is_pressed));
-					const uint8_t key_index{static_cast<uint8_t>(KEY_COUNT - key_num)};
-					_key_events.push_back(KeyEvent { event_type, key_index });
-				}
+		if (!_program_loaded) {
+			return;
+		}
+		for (size_t index = 0; index < MACHINE_COUNT; index++) {
+			ScanMachine& machine{_machines[index]};
+			count_rx_stalls(machine);
+			if (_mode == PIOKeyboardMode::DMA) {
+				poll_dma_ring(index);
+				continue;
+			}
+			while (!pio_sm_is_rx_fifo_empty(_pio, machine.state_machine)) {
+				process_state(index, pio_sm_get(_pio, machine.state_machine));
 			}
-			_previous_state = current_state;
 		}
 	}
+
+	bool is_pressed(uint8_t key_index) const {
+		return key_index < KEY_COUNT && (_key_bitmap[key_index / KEY_BITMAP_WORD_BITS] & (1U << (key_index % KEY_BITMAP_WORD_BITS))) != 0U;
+	}
+	// bit key_index % 32 of word key_index / 32 is set while the key is down
+	const std::array<uint32_t, KEY_BITMAP_WORDS>& key_bitmap() const {
+		return _key_bitmap;
+	}
+
+	// Key states handled by poll_buttons().
+	uint32_t states_processed() const {
+		return _states_processed;
+	}
+	// DMA mode only, states overwritten in a ring before they were read.
+	uint32_t states_dropped() const {
+		return _states_dropped;
+	}
+	// Polls that found a state machine had hit a full RX FIFO, the scan
+	// stopped for a while or, in lockstep, a state was lost. Stays 0 in DMA
+	// mode unless DMA is starved.
+	uint32_t rx_stall_count() const {
+		return _rx_stall_count;
+	}
 	void print_key_events() const {
-		for (const auto& event : _key_events) {
+		_key_events.for_each([](const KeyEvent& event) {
 			switch (event.event_type) {
 				case KeyEventE::KEY_DOWN:
 					printf("down");
@@ -74,27 +180,221 @@ public:
 					break;
 			}
 			printf(" %i\n", event.key_index);
-		}
+		});
 		printf("\n");
 	}
-	KeyEvent const* get_event_ptr(size_t* event_count) {
-		*event_count = _key_events.size();
-		return &_key_events[0];
-	} 
+	// Events queue until the consumer takes them, see KeyEventQueue.
+	KeyEventSpan peek_events() const {
+		return _key_events.peek();
+	}
+	void consume_events(size_t count) {
+		_key_events.consume(count);
+	}
+	template<typename F>
+	size_t drain_events(F&& f) {
+		return _key_events.drain(f);
+	}
+	size_t events_pending() const {
+		return _key_events.size();
+	}
+	// events dropped because the queue was full
+	uint32_t event_overrun_count() const {
+		return _key_events.overrun_count();
+	}
 	void clear_events() {
 		_key_events.clear();
 	}
 private:
+	// rows per group, rebalanced so the last group is not mostly empty
+	static constexpr uint8_t MAX_ROWS_PER_MACHINE{static_cast<uint8_t>(
+		row_count < PIO_KEYBOARD_KEYS_PER_MACHINE / col_count ? row_count : PIO_KEYBOARD_KEYS_PER_MACHINE / col_count)};
+	static constexpr size_t MACHINE_COUNT{(row_count + MAX_ROWS_PER_MACHINE - 1) / MAX_ROWS_PER_MACHINE};
+	static constexpr uint8_t ROWS_PER_MACHINE{static_cast<uint8_t>((row_count + MACHINE_COUNT - 1) / MACHINE_COUNT)};
+
+	static constexpr PioScanProgram SCAN_PROGRAM{make_pio_scan_program(ROWS_PER_MACHINE, col_count, MACHINE_COUNT > 1)};
+
+	static constexpr uint8_t NO_KEY{0xFF};
+	/*
+	Key index of each bit a machine pushes. Rows shift in from the bottom,
+	the last column read ends up in the lowest bits:
+		bit = (col_count - 1 - col) * ROWS_PER_MACHINE + row in group
+	The last group may read pins past the last row, they map to NO_KEY.
+	*/
+	static constexpr std::array<std::array<uint8_t, PIO_KEYBOARD_KEYS_PER_MACHINE>, MACHINE_COUNT> make_key_lookup() {
+		std::array<std::array<uint8_t, PIO_KEYBOARD_KEYS_PER_MACHINE>, MACHINE_COUNT> lookup{};
+		for (size_t machine = 0; machine < MACHINE_COUNT; machine++) {
+			for (size_t bit = 0; bit < PIO_KEYBOARD_KEYS_PER_MACHINE; bit++) {
+				const size_t col{col_count - 1 - bit / ROWS_PER_MACHINE};
+				const size_t row{machine * ROWS_PER_MACHINE + bit % ROWS_PER_MACHINE};
+				const bool valid{bit < static_cast<size_t>(ROWS_PER_MACHINE) * col_count && row < row_count};
+				lookup[machine][bit] = valid ? static_cast<uint8_t>(col * row_count + row) : NO_KEY;
+			}
+		}
+		return lookup;
+	}
+	static constexpr std::array<uint32_t, MACHINE_COUNT> make_valid_bits() {
+		std::array<uint32_t, MACHINE_COUNT> valid_bits{};
+		for (size_t machine = 0; machine < MACHINE_COUNT; machine++) {
+			for (size_t bit = 0; bit < PIO_KEYBOARD_KEYS_PER_MACHINE; bit++) {
+				if (KEY_LOOKUP[machine][bit] != NO_KEY) {
+					valid_bits[machine] |= 1U << bit;
+				}
+			}
+		}
+		return valid_bits;
+	}
+	static constexpr auto KEY_LOOKUP{make_key_lookup()};
+	static constexpr auto VALID_BITS{make_valid_bits()};
+
+	struct ScanMachine {
+		uint32_t state_machine;
+		uint32_t dma_channel;
+		uint32_t states_read;
+		uint32_t previous_state;
+	};
+
+	bool claim_state_machines() {
+		for (size_t index = 0; index < MACHINE_COUNT; index++) {
+			const int32_t state_machine{pio_claim_unused_sm(_pio, false)};
+			if (state_machine < 0) {
+				for (size_t claimed = 0; claimed < index; claimed++) {
+					pio_sm_unclaim(_pio, _machines[claimed].state_machine);
+				}
+				return false;
+			}
+			_machines[index].state_machine = state_machine;
+			_machine_mask |= 1U << state_machine;
+		}
+		return true;
+	}
+	void init_state_machines() {
+		for (uint8_t row = 0; row < row_count; row++) {
+			const uint8_t row_pin = _first_row_pin + row;
+			gpio_init(row_pin);
+			gpio_set_dir(row_pin, GPIO_IN);
+			gpio_pull_up(row_pin);
+		}
+		for (uint8_t col = 0; col < col_count; col++) {
+			pio_gpio_init(_pio, _first_col_pin + col);
+		}
+		// only the first machine drives the columns
+		const uint32_t column_driver{_machines[0].state_machine};
+		pio_sm_set_consecutive_pindirs(_pio, column_driver, _first_col_pin, col_count, true);
+
+		for (size_t index = 0; index < MACHINE_COUNT; index++) {
+			const uint32_t state_machine{_machines[index].state_machine};
+			const uint8_t driven_cols{state_machine == column_driver ? col_count : static_cast<uint8_t>(0)};
+
+			pio_sm_config config{pio_get_default_sm_config()};
+			sm_config_set_wrap(&config, _program_offset + SCAN_PROGRAM.wrap_target, _program_offset + SCAN_PROGRAM.wrap);
+			if (!SCAN_PROGRAM.uses_column_walker) {
+				sm_config_set_set_pins(&config, _first_col_pin, driven_cols);
+			}
+			sm_config_set_out_pins(&config, _first_col_pin, driven_cols);
+			// shift left, the walker loop ends after col_count shifts
+			sm_config_set_out_shift(&config, false, false, col_count);
+			sm_config_set_in_pins(&config, _first_row_pin + index * ROWS_PER_MACHINE);
+			sm_config_set_in_shift(&config, false, false, 0);
+			// Join the RX and TX FIFOs to be used only for RX
+			sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_RX);
+			pio_sm_init(_pio, state_machine, _program_offset, &config);
+		}
+	}
+
+	// Transfers run down from this, at one per key change it never runs out.
+	static constexpr uint32_t DMA_TRANSFER_COUNT{0xFFFFFFFF};
+
+	bool start_dma() {
+		for (size_t index = 0; index < MACHINE_COUNT; index++) {
+			const int32_t channel{dma_claim_unused_channel(false)};
+			if (channel < 0) {
+				for (size_t claimed = 0; claimed < index; claimed++) {
+					dma_channel_abort(_machines[claimed].dma_channel);
+					dma_channel_unclaim(_machines[claimed].dma_channel);
+				}
+				return false;
+			}
+			ScanMachine& machine{_machines[index]};
+			machine.dma_channel = channel;
+			dma_channel_config config{dma_channel_get_default_config(machine.dma_channel)};
+			channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+			channel_config_set_read_increment(&config, false);
+			channel_config_set_write_increment(&config, true);
+			// wrap the write address on the ring's alignment
+			channel_config_set_ring(&config, true, PIO_KEYBOARD_STATE_RING_BITS);
+			channel_config_set_dreq(&config, pio_get_dreq(_pio, machine.state_machine, false));
+			dma_channel_configure(machine.dma_channel, &config,
+				_state_rings[index].data(),
+				&_pio->rxf[machine.state_machine],
+				DMA_TRANSFER_COUNT,
+				true);
+		}
+		return true;
+	}
+	static uint32_t dma_states_written(const ScanMachine& machine) {
+		return DMA_TRANSFER_COUNT - dma_channel_hw_addr(machine.dma_channel)->transfer_count;
+	}
+	void poll_dma_ring(size_t index) {
+		ScanMachine& machine{_machines[index]};
+		const auto& ring{_state_rings[index]};
+		const uint32_t written{dma_states_written(machine)};
+		if (written - machine.states_read > PIO_KEYBOARD_STATE_RING_SIZE) {
+			const uint32_t oldest{written - PIO_KEYBOARD_STATE_RING_SIZE};
+			_states_dropped += oldest - machine.states_read;
+			machine.states_read = oldest;
+		}
+		const uint32_t first{machine.states_read};
+		for (; machine.states_read != written; machine.states_read++) {
+			// written behind the compiler's back
+			process_state(index, static_cast<const volatile uint32_t&>(ring[machine.states_read % PIO_KEYBOARD_STATE_RING_SIZE]));
+		}
+		// slots the DMA reused while they were being read held newer states
+		const uint32_t reused{dma_states_written(machine) - PIO_KEYBOARD_STATE_RING_SIZE - first};
+		if (static_cast<int32_t>(reused) > 0) {
+			const uint32_t read{written - first};
+			_states_dropped += reused < read ? reused : read;
+		}
+	}
+	void count_rx_stalls(const ScanMachine& machine) {
+		const uint32_t stall_bit{1U << (PIO_FDEBUG_RXSTALL_LSB + machine.state_machine)};
+		if ((_pio->fdebug & stall_bit) != 0U) {
+			// write one to clear
+			_pio->fdebug = stall_bit;
+			_rx_stall_count++;
+		}
+	}
+	void process_state(size_t index, uint32_t pins) {
+		_states_processed++;
+		ScanMachine& machine{_machines[index]};
+		const uint32_t current_state{~pins & VALID_BITS[index]};
+		for_each_changed_bit(machine.previous_state, current_state, [this, index](uint8_t bit, bool is_down) {
+			const uint8_t key_index{KEY_LOOKUP[index][bit]};
+			const auto event_type = static_cast<KeyEventE>(KeyEventE::KEY_UP - static_cast<int>(is_down));
+			_key_bitmap[key_index / KEY_BITMAP_WORD_BITS] ^= 1U << (key_index % KEY_BITMAP_WORD_BITS);
+			_key_events.push(KeyEvent { event_type, key_index });
+		});
+		machine.previous_state = current_state;
+	}
+
 	uint8_t _first_row_pin;
 	uint8_t _first_col_pin;
 
-	const static uint8_t KEY_COUNT{row_count * col_count};
-
-	std::vector<KeyEvent> _key_events{std::vector<KeyEvent>()};
+	KeyEventQueue<KEY_EVENT_QUEUE_CAPACITY> _key_events;
+	std::array<uint32_t, KEY_BITMAP_WORDS> _key_bitmap{};
 
 	PIO _pio{pio0};
-	uint32_t _state_machine{0};
-	uint32_t _previous_state{0};
+	std::array<ScanMachine, MACHINE_COUNT> _machines{};
+	uint32_t _machine_mask{0};
+
+	const pio_program_t _program{SCAN_PROGRAM.instructions.data(), SCAN_PROGRAM.length, -1};
+	uint32_t _program_offset{0};
+	bool _program_loaded{false};
+
+	PIOKeyboardMode _mode;
+	uint32_t _states_processed{0};
+	uint32_t _states_dropped{0};
+	uint32_t _rx_stall_count{0};
+	alignas(1U << PIO_KEYBOARD_STATE_RING_BITS) std::array<std::array<uint32_t, PIO_KEYBOARD_STATE_RING_SIZE>, MACHINE_COUNT> _state_rings{};
 };
 
 #endif
@@ -0,0 +1,226 @@
+// File: pio_scan_program.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef PIO_SCAN_PROGRAM_HPP
+#define PIO_SCAN_PROGRAM_HPP
+
+#include <array>   // array
+#include <cstddef> // size_t
+#include <cstdint> // uint8_t, uint16_t
+
+constexpr size_t PIO_INSTRUCTION_MEMORY_SIZE{32};
+constexpr uint8_t PIO_MAX_DELAY{31};
+// set can only drive 5 pins
+constexpr uint8_t PIO_MAX_SET_PINS{5};
+// cycles to wait after driving a column before the rows are read
+constexpr uint8_t SCAN_SETTLE_DELAY{PIO_MAX_DELAY};
+
+/*
+PIO instruction encoders, see the RP2040 datasheet section 3.4. Only the
+forms the scan program uses, no side-set so bits 12:8 are all delay.
+*/
+enum class PioJmpCondition : uint8_t {
+	ALWAYS = 0,
+	X_NOT_Y = 5,
+	OSR_NOT_EMPTY = 7,
+};
+enum class PioSource : uint8_t {
+	PINS = 0,
+	X = 1,
+	Y = 2,
+	ZEROS = 3,
+	ISR = 6,
+	OSR = 7,
+};
+enum class PioDestination : uint8_t {
+	PINS = 0,
+	X = 1,
+	Y = 2,
+	DISCARD = 3,
+	ISR = 6,
+	OSR = 7,
+};
+enum class PioMovOp : uint8_t {
+	NONE = 0,
+	INVERT = 1,
+};
+
+constexpr uint16_t pio_asm_instruction(uint16_t opcode, uint8_t delay, uint8_t arguments) {
+	return static_cast<uint16_t>((opcode << 13) | ((delay & PIO_MAX_DELAY) << 8) | arguments);
+}
+constexpr uint16_t pio_asm_jmp(PioJmpCondition condition, uint8_t address) {
+	return pio_asm_instruction(0, 0, static_cast<uint8_t>((static_cast<uint8_t>(condition) << 5) | (address & 0x1F)));
+}
+// bit_count 32 encodes as 0
+constexpr uint16_t pio_asm_in(PioSource source, uint8_t bit_count) {
+	return pio_asm_instruction(2, 0, static_cast<uint8_t>((static_cast<uint8_t>(source) << 5) | (bit_count & 0x1F)));
+}
+constexpr uint16_t pio_asm_out(PioDestination destination, uint8_t bit_count) {
+	return pio_asm_instruction(3, 0, static_cast<uint8_t>((static_cast<uint8_t>(destination) << 5) | (bit_count & 0x1F)));
+}
+constexpr uint16_t pio_asm_push(bool block) {
+	return pio_asm_instruction(4, 0, static_cast<uint8_t>(block ? 0x20 : 0x00));
+}
+constexpr uint16_t pio_asm_mov(PioDestination destination, PioMovOp op, PioSource source, uint8_t delay = 0) {
+	return pio_asm_instruction(5, delay, static_cast<uint8_t>(
+		(static_cast<uint8_t>(destination) << 5) | (static_cast<uint8_t>(op) << 3) | static_cast<uint8_t>(source)));
+}
+constexpr uint16_t pio_asm_nop(uint8_t delay = 0) {
+	return pio_asm_mov(PioDestination::Y, PioMovOp::NONE, PioSource::Y, delay);
+}
+// set only has PINS, X, Y and PINDIRS, they share the destination numbers
+constexpr uint16_t pio_asm_set(PioDestination destination, uint8_t value, uint8_t delay = 0) {
+	return pio_asm_instruction(7, delay, static_cast<uint8_t>((static_cast<uint8_t>(destination) << 5) | (value & 0x1F)));
+}
+
+struct PioScanProgram {
+	std::array<uint16_t, PIO_INSTRUCTION_MEMORY_SIZE> instructions;
+	uint8_t length;
+	uint8_t wrap_target;
+	uint8_t wrap;
+	// the OSR walker counts columns with the pull threshold
+	bool uses_column_walker;
+};
+
+/*
+Matrix scan program for any size whose key states fit in 32 bits.
+
+X holds the previous state. Every pass clears the ISR, drives one column
+low at a time and shifts its rows into the ISR, then compares the
+inverted ISR (keys are active low) to X and pushes the raw pins when
+anything changed.
+
+Up to 5 columns the columns are unrolled with set. Beyond that a walking
+one in the OSR is driven inverted with mov pins, shifted left by out null
+and the loop ends once col_count bits have been shifted out, the pull
+threshold must be col_count with autopull off.
+
+lockstep is for several state machines running the program together, one
+driving the columns and the others only reading their rows. Both ways
+through the compare take three cycles so they never drift apart, and the
+push never blocks. A push to a full FIFO is lost and sets the RX stall
+flag.
+
+	start:        set x, 0
+	              mov x, ~x
+	              jmp poll
+	key_changed:  mov x, y
+	              push                          ; push noblock in lockstep
+	poll:         mov isr, null                 ; wrap target
+	  set:        set pins, ~(1 << col) [31]    ; per column
+	              nop [31]
+	              in pins, row_count
+	  walker:     set y, 1
+	              mov osr, y
+	  column:     mov pins, ~osr [31]
+	              nop [31]
+	              in pins, row_count
+	              out null, 1
+	              jmp !osre, column
+	              mov y, ~isr
+	              jmp x != y, key_changed       ; wrap
+	              nop [1]                       ; lockstep only, wrap
+*/
+constexpr PioScanProgram make_pio_scan_program(uint8_t row_count, uint8_t col_count, bool lockstep = false) {
+	PioScanProgram program{};
+	uint8_t pc{0};
+	const auto emit{[&program, &pc](uint16_t instruction) {
+		program.instructions[pc] = instruction;
+		pc++;
+	}};
+
+	constexpr uint8_t KEY_CHANGED{3};
+	constexpr uint8_t POLL{5};
+	emit(pio_asm_set(PioDestination::X, 0));
+	emit(pio_asm_mov(PioDestination::X, PioMovOp::INVERT, PioSource::X));
+	emit(pio_asm_jmp(PioJmpCondition::ALWAYS, POLL));
+	emit(pio_asm_mov(PioDestination::X, PioMovOp::NONE, PioSource::Y));
+	emit(pio_asm_push(!lockstep));
+
+	program.wrap_target = pc;
+	emit(pio_asm_mov(PioDestination::ISR, PioMovOp::NONE, PioSource::ZEROS));
+	if (col_count <= PIO_MAX_SET_PINS) {
+		// bits above col_count fall outside the set pins
+		constexpr uint8_t ALL_HIGH{0x1F};
+		for (uint8_t col = 0; col < col_count; col++) {
+			emit(pio_asm_set(PioDestination::PINS, static_cast<uint8_t>(ALL_HIGH & ~(1U << col)), SCAN_SETTLE_DELAY));
+			emit(pio_asm_nop(SCAN_SETTLE_DELAY));
+			emit(pio_asm_in(PioSource::PINS, row_count));
+		}
+	} else {
+		program.uses_column_walker = true;
+		emit(pio_asm_set(PioDestination::Y, 1));
+		emit(pio_asm_mov(PioDestination::OSR, PioMovOp::NONE, PioSource::Y));
+		const uint8_t column{pc};
+		emit(pio_asm_mov(PioDestination::PINS, PioMovOp::INVERT, PioSource::OSR, SCAN_SETTLE_DELAY));
+		emit(pio_asm_nop(SCAN_SETTLE_DELAY));
+		emit(pio_asm_in(PioSource::PINS, row_count));
+		emit(pio_asm_out(PioDestination::DISCARD, 1));
+		emit(pio_asm_jmp(PioJmpCondition::OSR_NOT_EMPTY, column));
+	}
+	emit(pio_asm_mov(PioDestination::Y, PioMovOp::INVERT, PioSource::ISR));
+	emit(pio_asm_jmp(PioJmpCondition::X_NOT_Y, KEY_CHANGED));
+	if (lockstep) {
+		// as long as mov x, y and push
+		emit(pio_asm_nop(1));
+	}
+	program.wrap = static_cast<uint8_t>(pc - 1);
+	program.length = pc;
+	return program;
+}
+
+/*
+Checks on the generated instruction stream, they fail the build.
+*/
+
+// the 3x3 program matches what pioasm built from the old keyboard_program.pio
+constexpr std::array<uint16_t, 17> PIO_SCAN_PROGRAM_3X3{
+	0xE020, 0xA029, 0x0005, 0xA022, 0x8020,
+	0xA0C3,
+	0xFF1E, 0xBF42, 0x4003,
+	0xFF1D, 0xBF42, 0x4003,
+	0xFF1B, 0xBF42, 0x4003,
+	0xA04E, 0x00A3,
+};
+constexpr bool pio_scan_program_matches(const PioScanProgram& program, const uint16_t* expected, size_t length) {
+	if (program.length != length) {
+		return false;
+	}
+	for (size_t i = 0; i < length; i++) {
+		if (program.instructions[i] != expected[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+static_assert(pio_scan_program_matches(make_pio_scan_program(3, 3), PIO_SCAN_PROGRAM_3X3.data(), PIO_SCAN_PROGRAM_3X3.size()));
+static_assert(make_pio_scan_program(3, 3).wrap_target == 5 && make_pio_scan_program(3, 3).wrap == 16);
+
+// set based sizes grow by three instructions per column
+static_assert(make_pio_scan_program(1, 1).length == 11);
+static_assert(make_pio_scan_program(6, 5).length == 23);
+static_assert(make_pio_scan_program(6, 5).instructions[18] == 0xFF0F); // set pins, 0b01111 [31]
+static_assert(!make_pio_scan_program(6, 5).uses_column_walker);
+
+// lockstep pushes without blocking and pads the no change path
+static_assert(make_pio_scan_program(3, 3, true).instructions[4] == 0x8000); // push noblock
+static_assert(make_pio_scan_program(3, 3, true).instructions[17] == 0xA142); // nop [1]
+static_assert(make_pio_scan_program(3, 3, true).length == 18 && make_pio_scan_program(3, 3, true).wrap == 17);
+
+// 4x8 and wider use the walker
+constexpr std::array<uint16_t, 15> PIO_SCAN_PROGRAM_4X8{
+	0xE020, 0xA029, 0x0005, 0xA022, 0x8020,
+	0xA0C3,
+	0xE041, 0xA0E2,
+	0xBF0F, 0xBF42, 0x4004, 0x6061, 0x00E8,
+	0xA04E, 0x00A3,
+};
+static_assert(pio_scan_program_matches(make_pio_scan_program(4, 8), PIO_SCAN_PROGRAM_4X8.data(), PIO_SCAN_PROGRAM_4X8.size()));
+static_assert(make_pio_scan_program(4, 8).uses_column_walker);
+// in pins, 32 encodes the count as 0
+static_assert(make_pio_scan_program(1, 32).instructions[10] == 0x4001);
+static_assert(make_pio_scan_program(32, 1).instructions[8] == 0x4000);
+
+#endif
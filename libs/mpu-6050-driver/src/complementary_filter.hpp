@@ -10,12 +10,42 @@ constexpr float RAD_2_DEG{57.295779513F};
 constexpr float DEFULAT_DT{1.0F/60.0F};
 constexpr float DEFAULT_GYRO_BIAS{0.975F};
 
-#include "pico/stdlib.h"
-#include "pico/types.h"
-
 #include <algorithm> // nth_element
 #include <array>     // array
 #include <cmath>     // atan2
+#include <cstdint>   // int16_t, int32_t, int64_t
+#include <tuple>     // tuple
+
+#include "fixed_point.hpp"
+#include "seqlock.hpp"
+
+// Filter output published for readers on either core.
+struct OrientationSnapshot {
+	float pitch;
+	float roll;
+	// number of updates the angles include
+	uint32_t sample_count;
+};
+
+// Pitch and roll in degrees from the direction of gravity alone.
+inline std::tuple<float, float> accelerometer_angles(const std::array<int16_t, 3> &accel) {
+	const int16_t accel_x{accel[0]};
+	const int16_t accel_y{accel[1]};
+	const int16_t accel_z{accel[2]};
+	const int32_t accel_x_squared{accel_x*accel_x};
+	const int32_t accel_y_squared{accel_y*accel_y};
+	const int32_t accel_z_squared{accel_z*accel_z};
+
+	const float accel_angle_pitch = std::atan2(
+			static_cast<float>(accel_x),
+			std::sqrt(static_cast<float>(accel_y_squared + accel_z_squared))
+		) * RAD_2_DEG;
+	const float accel_angle_roll = std::atan2(
+			static_cast<float>(accel_y),
+			std::sqrt(static_cast<float>(accel_x_squared + accel_z_squared))
+		) * RAD_2_DEG;
+	return {accel_angle_pitch, accel_angle_roll};
+}
 
 class ComplementaryFilter {
 public:
@@ -32,31 +62,28 @@ public:
 	ComplementaryFilter& operator=(const ComplementaryFilter&)=delete;
 	ComplementaryFilter& operator=(const ComplementaryFilter&&)=delete;
 
+	// Seconds until the next update(), for samples that are not evenly spaced.
+	void set_dt(float dt) {
+		_dt = dt;
+	}
 	void update(const std::array<int16_t, 3> &accel, const std::array<float, 3> &gyro) {
-		const int16_t accel_x{accel[0]};
-		const int16_t accel_y{accel[1]};
-		const int16_t accel_z{accel[2]};
-		const int32_t accel_x_squared{accel_x*accel_x};
-		const int32_t accel_y_squared{accel_y*accel_y};
-		const int32_t accel_z_squared{accel_z*accel_z};
-
-		const float accel_angle_pitch = std::atan2(
-				static_cast<float>(accel_x),
-				std::sqrt(static_cast<float>(accel_y_squared + accel_z_squared))
-			) * RAD_2_DEG;
-		const float accel_angle_roll = std::atan2(
-				static_cast<float>(accel_y),
-				std::sqrt(static_cast<float>(accel_x_squared + accel_z_squared))
-			) * RAD_2_DEG;
+		const auto [accel_angle_pitch, accel_angle_roll] = accelerometer_angles(accel);
 
 		_pitch = _gyro_bias * (_pitch - gyro[1]*_dt)
 			+ _accel_bias * accel_angle_pitch;
 		_roll = _gyro_bias * (_roll + gyro[0]*_dt)
 			+ _accel_bias * accel_angle_roll;
+
+		_sample_count++;
+		_snapshot.store(OrientationSnapshot{_pitch, _roll, _sample_count});
 	}
 	std::tuple<float, float> get_filtered_angles() {
 		return {_pitch, _roll};
 	}
+	// Safe to read from the other core while update() runs.
+	const Seqlock<OrientationSnapshot>& snapshot() const {
+		return _snapshot;
+	}
 private:
 	float _dt{DEFULAT_DT};
 
@@ -65,6 +92,82 @@ private:
 
 	float _pitch{0.0F};
 	float _roll{0.0F};
+
+	uint32_t _sample_count{0};
+	Seqlock<OrientationSnapshot> _snapshot;
+};
+
+/*
+ComplementaryFilter in Q16.16 fixed point, no floating point on the update
+path. Angles are in Q16 degrees and use the polynomial atan2 from
+fixed_point.hpp, so they are within about 0.09 degrees of the float filter's
+accelerometer angles before blending.
+
+Gyro rates are Q16 degrees per second, see ConfiguredMPU6050::get_gyro_q16().
+*/
+class FixedPointComplementaryFilter {
+public:
+	FixedPointComplementaryFilter()=default;
+	FixedPointComplementaryFilter(float dt, float gyro_bias)
+		: _dt{float_to_q16(dt)}
+		, _gyro_bias{float_to_q16(gyro_bias)}
+		, _accel_bias{Q16_ONE - _gyro_bias}
+	{}
+	~FixedPointComplementaryFilter()=default;
+
+	FixedPointComplementaryFilter(const FixedPointComplementaryFilter&)=delete;
+	FixedPointComplementaryFilter(const FixedPointComplementaryFilter&&)=delete;
+	FixedPointComplementaryFilter& operator=(const FixedPointComplementaryFilter&)=delete;
+	FixedPointComplementaryFilter& operator=(const FixedPointComplementaryFilter&&)=delete;
+
+	void set_dt(float dt) {
+		_dt = float_to_q16(dt);
+	}
+	void update(const std::array<int16_t, 3> &accel, const std::array<int32_t, 3> &gyro_q16) {
+		const int32_t accel_x{accel[0]};
+		const int32_t accel_y{accel[1]};
+		const int32_t accel_z{accel[2]};
+		const auto accel_x_squared{static_cast<uint32_t>(accel_x*accel_x)};
+		const auto accel_y_squared{static_cast<uint32_t>(accel_y*accel_y)};
+		const auto accel_z_squared{static_cast<uint32_t>(accel_z*accel_z)};
+
+		const int32_t accel_angle_pitch{atan2_q16_degrees(
+			accel_x,
+			static_cast<int32_t>(isqrt32(accel_y_squared + accel_z_squared))
+		)};
+		const int32_t accel_angle_roll{atan2_q16_degrees(
+			accel_y,
+			static_cast<int32_t>(isqrt32(accel_x_squared + accel_z_squared))
+		)};
+
+		_pitch = q16_multiply(_gyro_bias, _pitch - q16_multiply(gyro_q16[1], _dt))
+			+ q16_multiply(_accel_bias, accel_angle_pitch);
+		_roll = q16_multiply(_gyro_bias, _roll + q16_multiply(gyro_q16[0], _dt))
+			+ q16_multiply(_accel_bias, accel_angle_roll);
+	}
+	// Drop in for ComplementaryFilter::update(), converts the rates first.
+	void update(const std::array<int16_t, 3> &accel, const std::array<float, 3> &gyro) {
+		const std::array<int32_t, 3> gyro_q16{
+			float_to_q16(gyro[0]),
+			float_to_q16(gyro[1]),
+			float_to_q16(gyro[2])
+		};
+		update(accel, gyro_q16);
+	}
+	std::tuple<int32_t, int32_t> get_filtered_angles_q16() const {
+		return {_pitch, _roll};
+	}
+	std::tuple<float, float> get_filtered_angles() const {
+		return {q16_to_float(_pitch), q16_to_float(_roll)};
+	}
+private:
+	int32_t _dt{float_to_q16(DEFULAT_DT)};
+
+	int32_t _gyro_bias{float_to_q16(DEFAULT_GYRO_BIAS)};
+	int32_t _accel_bias{Q16_ONE - _gyro_bias};
+
+	int32_t _pitch{0};
+	int32_t _roll{0};
 };
 
 #endif
@@ -0,0 +1,199 @@
+// File: fixed_point.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef FIXED_POINT_HPP
+#define FIXED_POINT_HPP
+
+#include <cstdint> // int32_t, uint32_t
+#include <cstring> // memcpy
+
+// Q16.16, angles are in degrees and rates in degrees per second.
+constexpr int32_t Q16_ONE{1 << 16};
+constexpr int32_t Q15_ONE{1 << 15};
+
+constexpr int32_t float_to_q16(float value) {
+	return static_cast<int32_t>(value * static_cast<float>(Q16_ONE) + (value < 0.0F ? -0.5F : 0.5F));
+}
+constexpr float q16_to_float(int32_t value) {
+	return static_cast<float>(value) / static_cast<float>(Q16_ONE);
+}
+constexpr int32_t q16_multiply(int32_t a, int32_t b) {
+	return static_cast<int32_t>((static_cast<int64_t>(a) * b) >> 16);
+}
+
+// floor(sqrt(value)), exact for every input.
+constexpr uint32_t isqrt32(uint32_t value) {
+	uint32_t root{0};
+	uint32_t bit{1U << 30};
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit != 0U) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
+
+/*
+atan(z) for z in [0, 1] in Q15, result in Q16 degrees.
+	atan(z) ~= 45z + z(1 - z)(14.02 + 3.80z) degrees
+Max error is about 0.09 degrees.
+*/
+constexpr int32_t atan_unit_q16_degrees(int32_t z) {
+	constexpr int32_t C0{918815};  // 14.02 in Q16
+	constexpr int32_t C1{62259};   // 3.80 in Q14
+	const int32_t inner{C0 + ((C1 * z) >> 13)};               // Q16
+	const int32_t z_one_minus_z{(z * (Q15_ONE - z)) >> 15};   // Q15
+	return 45 * 2 * z + ((z_one_minus_z * (inner >> 4)) >> 11);
+}
+
+/*
+Four quadrant atan2 in Q16 degrees, within [-180, 180].
+|y| and |x| must be below 2^16, e.g. raw int16_t sensor values or
+isqrt32 of a sum of two squared ones.
+*/
+constexpr int32_t atan2_q16_degrees(int32_t y, int32_t x) {
+	const uint32_t abs_y{static_cast<uint32_t>(y < 0 ? -y : y)};
+	const uint32_t abs_x{static_cast<uint32_t>(x < 0 ? -x : x)};
+	if (abs_x == 0U && abs_y == 0U) {
+		return 0;
+	}
+
+	int32_t angle{0};
+	if (abs_y <= abs_x) {
+		angle = atan_unit_q16_degrees(static_cast<int32_t>((abs_y << 15) / abs_x));
+	} else {
+		angle = 90 * Q16_ONE - atan_unit_q16_degrees(static_cast<int32_t>((abs_x << 15) / abs_y));
+	}
+	if (x < 0) {
+		angle = 180 * Q16_ONE - angle;
+	}
+	return y < 0 ? -angle : angle;
+}
+
+/*
+Signed fixed point value with fraction_bits fractional bits in an int32_t.
+Products are formed in 64 bits, nothing saturates.
+*/
+template<int fraction_bits>
+class Fixed {
+public:
+	static constexpr int FRACTION_BITS{fraction_bits};
+
+	constexpr Fixed()=default;
+	constexpr explicit Fixed(float value)
+		: _raw{static_cast<int32_t>(value * ONE + (value < 0.0F ? -0.5F : 0.5F))}
+	{}
+	static constexpr Fixed from_raw(int32_t raw) {
+		Fixed value{};
+		value._raw = raw;
+		return value;
+	}
+
+	constexpr int32_t raw() const {
+		return _raw;
+	}
+	constexpr float to_float() const {
+		return static_cast<float>(_raw) / ONE;
+	}
+
+	constexpr Fixed operator-() const {
+		return from_raw(-_raw);
+	}
+	constexpr Fixed operator+(Fixed other) const {
+		return from_raw(_raw + other._raw);
+	}
+	constexpr Fixed operator-(Fixed other) const {
+		return from_raw(_raw - other._raw);
+	}
+	constexpr Fixed operator*(Fixed other) const {
+		return from_raw(static_cast<int32_t>((static_cast<int64_t>(_raw) * other._raw) >> fraction_bits));
+	}
+	constexpr Fixed& operator+=(Fixed other) {
+		_raw += other._raw;
+		return *this;
+	}
+	constexpr Fixed& operator-=(Fixed other) {
+		_raw -= other._raw;
+		return *this;
+	}
+	constexpr Fixed& operator*=(Fixed other) {
+		*this = *this * other;
+		return *this;
+	}
+	constexpr bool operator==(Fixed other) const {
+		return _raw == other._raw;
+	}
+	constexpr bool operator!=(Fixed other) const {
+		return _raw != other._raw;
+	}
+	constexpr bool operator<(Fixed other) const {
+		return _raw < other._raw;
+	}
+	constexpr bool operator>(Fixed other) const {
+		return _raw > other._raw;
+	}
+private:
+	static constexpr float ONE{static_cast<float>(int64_t{1} << fraction_bits)};
+
+	int32_t _raw{0};
+};
+
+constexpr int32_t most_significant_bit(uint32_t value) {
+	int32_t bit{-1};
+	while (value != 0U) {
+		value >>= 1;
+		bit++;
+	}
+	return bit;
+}
+
+/*
+1 / sqrt(x) from a power of two first guess and three Newton steps, relative
+error below 4e-5, and below 1e-5 for x near 1. x must be at least 2^-12 for
+Fixed<24>, zero and negative inputs return zero.
+*/
+template<int fraction_bits>
+constexpr Fixed<fraction_bits> inv_sqrt(Fixed<fraction_bits> x) {
+	if (x.raw() <= 0) {
+		return Fixed<fraction_bits>{};
+	}
+	const int64_t value{x.raw()};
+	// x in [2^exponent, 2^(exponent + 1)), the guess is within 19% of 1 / sqrt(x)
+	const int32_t exponent{most_significant_bit(static_cast<uint32_t>(x.raw())) - fraction_bits};
+	const int32_t shift{fraction_bits - (exponent >> 1)};
+	constexpr int64_t EVEN_GUESS{55050};  // 0.84 in Q16
+	constexpr int64_t ODD_GUESS{38924};   // 0.84 / sqrt(2) in Q16
+	int64_t y{((int64_t{1} << shift) * ((exponent & 1) != 0 ? ODD_GUESS : EVEN_GUESS)) >> 16};
+
+	constexpr int64_t THREE{int64_t{3} << fraction_bits};
+	for (int i = 0; i < 3; i++) {
+		const int64_t y_squared{(y * y) >> fraction_bits};
+		const int64_t x_y_squared{(value * y_squared) >> fraction_bits};
+		y = (y * (THREE - x_y_squared)) >> (fraction_bits + 1);
+	}
+	return Fixed<fraction_bits>::from_raw(static_cast<int32_t>(y));
+}
+
+// Fast inverse square root, one magic constant guess and two Newton steps.
+inline float inv_sqrt(float x) {
+	uint32_t bits{0};
+	std::memcpy(&bits, &x, sizeof(bits));
+	bits = 0x5F375A86U - (bits >> 1);
+	float y{0.0F};
+	std::memcpy(&y, &bits, sizeof(y));
+	const float half_x{0.5F * x};
+	y = y * (1.5F - half_x * y * y);
+	y = y * (1.5F - half_x * y * y);
+	return y;
+}
+
+#endif
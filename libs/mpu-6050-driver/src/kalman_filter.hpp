@@ -0,0 +1,133 @@
+// File: kalman_filter.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef KALMAN_FILTER_HPP
+#define KALMAN_FILTER_HPP
+
+constexpr float DEFAULT_Q_ANGLE{0.001F};
+constexpr float DEFAULT_Q_BIAS{0.003F};
+constexpr float DEFAULT_R_MEASURE{0.03F};
+
+#include <array>   // array
+#include <cstdint> // int16_t
+#include <tuple>   // tuple
+
+#include "complementary_filter.hpp"
+
+struct KalmanNoise {
+	float q_angle{DEFAULT_Q_ANGLE};    // process noise of the angle
+	float q_bias{DEFAULT_Q_BIAS};      // process noise of the gyro bias
+	float r_measure{DEFAULT_R_MEASURE}; // accelerometer angle noise
+};
+
+/*
+Kalman filter for one axis with the state [angle, gyro bias]. The gyro rate
+drives the prediction and the accelerometer angle is the measurement, so the
+bias is learned continuously instead of from a one off calibration.
+
+The state and covariance are fixed 2 and 2x2 arrays and the matrix products
+are written out, an update is about twenty float operations and one divide.
+*/
+class AngleKalmanFilter {
+public:
+	AngleKalmanFilter()=default;
+	explicit AngleKalmanFilter(const KalmanNoise &noise)
+		: _noise{noise}
+	{}
+
+	void reset(float angle) {
+		_angle = angle;
+		_bias = 0.0F;
+		_p = {};
+	}
+	void update(float measured_angle, float rate, float dt) {
+		// predict, x = F x + B u
+		_angle += dt * (rate - _bias);
+		// P = F P F' + Q
+		_p[0][0] += dt * (dt * _p[1][1] - _p[0][1] - _p[1][0] + _noise.q_angle);
+		_p[0][1] -= dt * _p[1][1];
+		_p[1][0] -= dt * _p[1][1];
+		_p[1][1] += dt * _noise.q_bias;
+
+		// correct, H = [1 0]
+		const float innovation_variance{_p[0][0] + _noise.r_measure};
+		const float gain_angle{_p[0][0] / innovation_variance};
+		const float gain_bias{_p[1][0] / innovation_variance};
+		const float innovation{measured_angle - _angle};
+		_angle += gain_angle * innovation;
+		_bias += gain_bias * innovation;
+
+		const float p00{_p[0][0]};
+		const float p01{_p[0][1]};
+		_p[0][0] -= gain_angle * p00;
+		_p[0][1] -= gain_angle * p01;
+		_p[1][0] -= gain_bias * p00;
+		_p[1][1] -= gain_bias * p01;
+	}
+
+	float angle() const {
+		return _angle;
+	}
+	float bias() const {
+		return _bias;
+	}
+private:
+	KalmanNoise _noise{};
+
+	float _angle{0.0F};
+	float _bias{0.0F};
+	std::array<std::array<float, 2>, 2> _p{};
+};
+
+/*
+Pitch and roll with the ComplementaryFilter interface, one AngleKalmanFilter
+per axis. The first update starts both axes at the accelerometer angles.
+*/
+class KalmanFilter {
+public:
+	KalmanFilter()=default;
+	explicit KalmanFilter(float dt, const KalmanNoise &noise=KalmanNoise{})
+		: _dt{dt}
+		, _pitch{noise}
+		, _roll{noise}
+	{}
+	~KalmanFilter()=default;
+
+	KalmanFilter(const KalmanFilter&)=delete;
+	KalmanFilter(const KalmanFilter&&)=delete;
+	KalmanFilter& operator=(const KalmanFilter&)=delete;
+	KalmanFilter& operator=(const KalmanFilter&&)=delete;
+
+	// Seconds since the previous update(), both axes use it.
+	void set_dt(float dt) {
+		_dt = dt;
+	}
+	void update(const std::array<int16_t, 3> &accel, const std::array<float, 3> &gyro) {
+		const auto [accel_angle_pitch, accel_angle_roll] = accelerometer_angles(accel);
+		if (!_started) {
+			_pitch.reset(accel_angle_pitch);
+			_roll.reset(accel_angle_roll);
+			_started = true;
+			return;
+		}
+		_pitch.update(accel_angle_pitch, -gyro[1], _dt);
+		_roll.update(accel_angle_roll, gyro[0], _dt);
+	}
+	std::tuple<float, float> get_filtered_angles() const {
+		return {_pitch.angle(), _roll.angle()};
+	}
+	// Estimated x and y gyro biases in degrees per second, subtract from the rates.
+	std::tuple<float, float> get_gyro_biases() const {
+		return {_roll.bias(), -_pitch.bias()};
+	}
+private:
+	float _dt{DEFULAT_DT};
+	bool _started{false};
+
+	AngleKalmanFilter _pitch{};
+	AngleKalmanFilter _roll{};
+};
+
+#endif
@@ -0,0 +1,210 @@
+// File: mahony_filter.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef MAHONY_FILTER_HPP
+#define MAHONY_FILTER_HPP
+
+constexpr float DEG_2_RAD{0.017453293F};
+constexpr float DEFAULT_MAHONY_KP{0.5F};
+constexpr float DEFAULT_MAHONY_KI{0.0F};
+
+#include <array>       // array
+#include <cmath>       // atan2, asin
+#include <cstdint>     // int16_t, int32_t, int64_t
+#include <tuple>       // tuple
+#include <type_traits> // is_floating_point
+
+#include "complementary_filter.hpp"
+#include "fixed_point.hpp"
+
+template<typename T>
+struct Quaternion {
+	T w;
+	T x;
+	T y;
+	T z;
+};
+
+// Degrees, pitch and roll follow ComplementaryFilter's signs.
+struct EulerAngles {
+	float pitch;
+	float roll;
+	float yaw;
+};
+
+/*
+Mahony's attitude filter for a 6 axis IMU. The orientation is a unit
+quaternion corrected toward the measured gravity direction by a PI
+controller, so there is no gimbal lock and yaw is tracked from the gyro
+alone (it drifts without a magnetometer).
+
+An update is multiplies, adds and two inverse square roots, no trig. Euler
+angles are only computed when asked for.
+
+T is float or Fixed<24>, see FixedPointMahonyFilter.
+*/
+template<typename T>
+class MahonyFilter {
+public:
+	MahonyFilter()=default;
+	MahonyFilter(float dt, float kp=DEFAULT_MAHONY_KP, float ki=DEFAULT_MAHONY_KI)
+		: _half_dt{0.5F * dt}
+		, _dt{dt}
+		, _two_kp{2.0F * kp}
+		, _two_ki{2.0F * ki}
+	{}
+	~MahonyFilter()=default;
+
+	MahonyFilter(const MahonyFilter&)=delete;
+	MahonyFilter(const MahonyFilter&&)=delete;
+	MahonyFilter& operator=(const MahonyFilter&)=delete;
+	MahonyFilter& operator=(const MahonyFilter&&)=delete;
+
+	// Integration step in seconds, may change between updates.
+	void set_dt(float dt) {
+		_half_dt = T{0.5F * dt};
+		_dt = T{dt};
+	}
+	// Gyro rates in degrees per second.
+	void update(const std::array<int16_t, 3> &accel, const std::array<float, 3> &gyro) {
+		update_radians(accel, {
+			T{gyro[0] * DEG_2_RAD},
+			T{gyro[1] * DEG_2_RAD},
+			T{gyro[2] * DEG_2_RAD}
+		});
+	}
+	// Gyro rates in Q16 degrees per second, see ConfiguredMPU6050::get_gyro_q16().
+	void update(const std::array<int16_t, 3> &accel, const std::array<int32_t, 3> &gyro_q16) {
+		update_radians(accel, {
+			q16_degrees_to_radians(gyro_q16[0]),
+			q16_degrees_to_radians(gyro_q16[1]),
+			q16_degrees_to_radians(gyro_q16[2])
+		});
+	}
+
+	const Quaternion<T>& get_quaternion() const {
+		return _q;
+	}
+	EulerAngles get_euler_angles() const {
+		const T two{2.0F};
+		const T sin_pitch{two * (_q.x * _q.z - _q.w * _q.y)};
+		const T roll_y{two * (_q.w * _q.x + _q.y * _q.z)};
+		const T roll_x{_q.w * _q.w - _q.x * _q.x - _q.y * _q.y + _q.z * _q.z};
+		const T yaw_y{two * (_q.w * _q.z + _q.x * _q.y)};
+		const T yaw_x{_q.w * _q.w + _q.x * _q.x - _q.y * _q.y - _q.z * _q.z};
+
+		if constexpr (std::is_floating_point_v<T>) {
+			const float clamped{sin_pitch < -1.0F ? -1.0F : (sin_pitch > 1.0F ? 1.0F : sin_pitch)};
+			return {
+				std::asin(clamped) * RAD_2_DEG,
+				std::atan2(roll_y, roll_x) * RAD_2_DEG,
+				std::atan2(yaw_y, yaw_x) * RAD_2_DEG
+			};
+		} else {
+			// atan2_q16_degrees wants inputs below 2^16, use Q14
+			constexpr int shift{T::FRACTION_BITS - 14};
+			const int32_t sin_pitch_q14{clamp_q14(sin_pitch.raw() >> shift)};
+			const auto cos_pitch_q14{static_cast<int32_t>(isqrt32(
+				static_cast<uint32_t>((1 << 28) - sin_pitch_q14 * sin_pitch_q14)
+			))};
+			return {
+				q16_to_float(atan2_q16_degrees(sin_pitch_q14, cos_pitch_q14)),
+				q16_to_float(atan2_q16_degrees(roll_y.raw() >> shift, roll_x.raw() >> shift)),
+				q16_to_float(atan2_q16_degrees(yaw_y.raw() >> shift, yaw_x.raw() >> shift))
+			};
+		}
+	}
+	// Drop in for ComplementaryFilter::get_filtered_angles().
+	std::tuple<float, float> get_filtered_angles() const {
+		const EulerAngles angles{get_euler_angles()};
+		return {angles.pitch, angles.roll};
+	}
+private:
+	void update_radians(const std::array<int16_t, 3> &accel, std::array<T, 3> gyro) {
+		const Quaternion<T> q{_q};
+
+		if (accel[0] != 0 || accel[1] != 0 || accel[2] != 0) {
+			// only the direction matters, bring raw counts near 1 so Fixed<24> has headroom
+			T ax{raw_accel_to_value(accel[0])};
+			T ay{raw_accel_to_value(accel[1])};
+			T az{raw_accel_to_value(accel[2])};
+			const T accel_norm_reciprocal{inv_sqrt(ax * ax + ay * ay + az * az)};
+			ax *= accel_norm_reciprocal;
+			ay *= accel_norm_reciprocal;
+			az *= accel_norm_reciprocal;
+
+			// half the gravity direction predicted by q
+			const T half_vx{q.x * q.z - q.w * q.y};
+			const T half_vy{q.w * q.x + q.y * q.z};
+			const T half_vz{q.w * q.w - T{0.5F} + q.z * q.z};
+
+			// half the error, cross product of measured and predicted gravity
+			const T half_ex{ay * half_vz - az * half_vy};
+			const T half_ey{az * half_vx - ax * half_vz};
+			const T half_ez{ax * half_vy - ay * half_vx};
+
+			if (_two_ki > T{}) {
+				_integral[0] += _two_ki * half_ex * _dt;
+				_integral[1] += _two_ki * half_ey * _dt;
+				_integral[2] += _two_ki * half_ez * _dt;
+				gyro[0] += _integral[0];
+				gyro[1] += _integral[1];
+				gyro[2] += _integral[2];
+			}
+			gyro[0] += _two_kp * half_ex;
+			gyro[1] += _two_kp * half_ey;
+			gyro[2] += _two_kp * half_ez;
+		}
+
+		const T gx{gyro[0] * _half_dt};
+		const T gy{gyro[1] * _half_dt};
+		const T gz{gyro[2] * _half_dt};
+		_q.w += -q.x * gx - q.y * gy - q.z * gz;
+		_q.x += q.w * gx + q.y * gz - q.z * gy;
+		_q.y += q.w * gy - q.x * gz + q.z * gx;
+		_q.z += q.w * gz + q.x * gy - q.y * gx;
+
+		const T norm_reciprocal{inv_sqrt(_q.w * _q.w + _q.x * _q.x + _q.y * _q.y + _q.z * _q.z)};
+		_q.w *= norm_reciprocal;
+		_q.x *= norm_reciprocal;
+		_q.y *= norm_reciprocal;
+		_q.z *= norm_reciprocal;
+	}
+
+	// raw / 2^14
+	static T raw_accel_to_value(int16_t raw) {
+		if constexpr (std::is_floating_point_v<T>) {
+			return static_cast<T>(raw) * T{1.0F / 16384.0F};
+		} else {
+			return T::from_raw(static_cast<int32_t>(raw) * (1 << (T::FRACTION_BITS - 14)));
+		}
+	}
+	static T q16_degrees_to_radians(int32_t value) {
+		if constexpr (std::is_floating_point_v<T>) {
+			return q16_to_float(value) * DEG_2_RAD;
+		} else {
+			constexpr int64_t DEG_2_RAD_Q32{74961321};
+			return T::from_raw(static_cast<int32_t>(
+				(static_cast<int64_t>(value) * DEG_2_RAD_Q32) >> (48 - T::FRACTION_BITS)
+			));
+		}
+	}
+	static int32_t clamp_q14(int32_t value) {
+		constexpr int32_t ONE_Q14{1 << 14};
+		return value < -ONE_Q14 ? -ONE_Q14 : (value > ONE_Q14 ? ONE_Q14 : value);
+	}
+
+	T _half_dt{0.5F * DEFULAT_DT};
+	T _dt{DEFULAT_DT};
+	T _two_kp{2.0F * DEFAULT_MAHONY_KP};
+	T _two_ki{2.0F * DEFAULT_MAHONY_KI};
+
+	Quaternion<T> _q{T{1.0F}, T{}, T{}, T{}};
+	std::array<T, 3> _integral{};
+};
+
+using FixedPointMahonyFilter = MahonyFilter<Fixed<24>>;
+
+#endif
@@ -6,28 +6,43 @@
 #ifndef MEDIAN_FILTER_HPP
 #define MEDIAN_FILTER_HPP
 
-#include <algorithm> // std::partial_sort
-#include <cstring>   // memcpy
+#include <algorithm>   // nth_element
+#include <array>       // array
+#include <cstddef>     // size_t
+#include <cstdint>     // int16_t
+#include <type_traits> // is_integral
+#include <utility>     // index_sequence
 
-#include "pico/util/queue.h"
+/*
+Sliding window median.
 
+The window is kept as two heaps that meet at the median: a max heap of the
+values below it and a min heap of the values above it. Every value knows its
+heap position, so the oldest value is replaced in place and sifted, making
+update() O(log sz) and get_median() O(1). Nothing is allocated and no locks
+are taken.
+
+Heap positions are signed, 0 is the median, -1, -2, ... the max heap and
+1, 2, ... the min heap.
 
-/*
 Invariants: sz is odd
 */
-template<size_t sz>
+template<size_t sz, typename T = int16_t>
 class MedianFilter {
 public:
-	using element_t = int16_t;
+	using element_t = T;
 	MedianFilter()
 		: _data{}
 	{
-		queue_init(&_window, sizeof(element_t), sz);
-		assert(sz % 2 != 0);
-	};
-	~MedianFilter() {
-		queue_free(&_window);
+		static_assert(sz % 2 != 0, "the window size must be odd");
+		// fill order alternates median, max heap, min heap, ...
+		for (size_t i = 0; i < sz; i++) {
+			const int32_t position{static_cast<int32_t>((i + 1) / 2) * ((i & 1U) != 0U ? -1 : 1)};
+			_position[i] = position;
+			heap(position) = i;
+		}
 	};
+	~MedianFilter()=default;
 
 	MedianFilter(const MedianFilter&)=delete;
 	MedianFilter(const MedianFilter&&)=delete;
@@ -35,26 +50,302 @@ public:
 	MedianFilter& operator=(const MedianFilter&&)=delete;
 
 	void update(element_t value) {
-		if (queue_is_full(&_window)) {
-			queue_try_remove(&_window, nullptr);
-		}
-		queue_try_add(&_window, &value);
-	}
-	element_t get_median() {
-		// number of elements in queue [0, sz)
-		const uint32_t size{queue_get_level(&_window)};
-		// copy queue data into array of element_t
-		memcpy(&_data, _window.data, _data_size_bytes);
-		// middle point for median
-		const uint32_t middle{size/2};
-		// puts the median at middle
-		std::nth_element(_data.begin(), _data.begin() + middle, _data.begin() + size);
-		return _data[middle];
+		const bool is_new{_count < sz};
+		const int32_t position{_position[_oldest]};
+		const element_t old_value{_data[_oldest]};
+
+		_data[_oldest] = value;
+		_oldest = (_oldest + 1) % sz;
+		_count += is_new ? 1 : 0;
+
+		if (position > 0) {
+			// replaced a value in the min heap
+			if (!is_new && old_value < value) {
+				min_sort_down(position * 2);
+			} else if (min_sort_up(position)) {
+				max_sort_down(-1);
+			}
+		} else if (position < 0) {
+			// replaced a value in the max heap
+			if (!is_new && value < old_value) {
+				max_sort_down(position * 2);
+			} else if (max_sort_up(position) && _count != 0) {
+				min_sort_down(1);
+			}
+		} else {
+			// replaced the median
+			if (max_count() != 0) {
+				max_sort_down(-1);
+			}
+			if (min_count() != 0) {
+				min_sort_down(1);
+			}
+		}
+	}
+	// With an even number of values, while the window fills, this is the upper median.
+	element_t get_median() const {
+		return _data[heap(0)];
 	}
 private:
-	queue_t _window;
+	size_t min_count() const {
+		return _count == 0 ? 0 : (_count - 1) / 2;
+	}
+	size_t max_count() const {
+		return _count / 2;
+	}
+
+	size_t& heap(int32_t position) {
+		return _heap[position + static_cast<int32_t>(sz / 2)];
+	}
+	size_t heap(int32_t position) const {
+		return _heap[position + static_cast<int32_t>(sz / 2)];
+	}
+	bool less(int32_t i, int32_t j) const {
+		return _data[heap(i)] < _data[heap(j)];
+	}
+	void exchange(int32_t i, int32_t j) {
+		const size_t temp{heap(i)};
+		heap(i) = heap(j);
+		heap(j) = temp;
+		_position[heap(i)] = i;
+		_position[heap(j)] = j;
+	}
+	// swaps i and j when the value at i is less than the value at j
+	bool compare_exchange(int32_t i, int32_t j) {
+		if (less(i, j)) {
+			exchange(i, j);
+			return true;
+		}
+		return false;
+	}
+
+	// restores the min heap property from i / 2 down
+	void min_sort_down(int32_t i) {
+		const auto count{static_cast<int32_t>(min_count())};
+		for (; i <= count; i *= 2) {
+			if (i > 1 && i < count && less(i + 1, i)) {
+				i++;
+			}
+			if (!compare_exchange(i, i / 2)) {
+				break;
+			}
+		}
+	}
+	// restores the max heap property from i / 2 down
+	void max_sort_down(int32_t i) {
+		const auto count{static_cast<int32_t>(max_count())};
+		for (; i >= -count; i *= 2) {
+			if (i < -1 && i > -count && less(i, i - 1)) {
+				i--;
+			}
+			if (!compare_exchange(i / 2, i)) {
+				break;
+			}
+		}
+	}
+	// returns true when the value reached the median
+	bool min_sort_up(int32_t i) {
+		while (i > 0 && compare_exchange(i, i / 2)) {
+			i /= 2;
+		}
+		return i == 0;
+	}
+	bool max_sort_up(int32_t i) {
+		while (i < 0 && compare_exchange(i / 2, i)) {
+			i /= 2;
+		}
+		return i == 0;
+	}
+
+	// values in arrival order, _oldest is overwritten next
 	std::array<element_t, sz> _data;
-	uint32_t _data_size_bytes{sizeof(element_t) * sz};
+	// heap position of each value in _data
+	std::array<int32_t, sz> _position{};
+	// index into _data for every heap position, offset by sz / 2
+	std::array<size_t, sz> _heap{};
+	size_t _oldest{0};
+	size_t _count{0};
+};
+
+// Windows up to this size use a selection network in MultiChannelMedianFilter.
+constexpr size_t MAX_NETWORK_MEDIAN_SIZE{11};
+
+struct CompareExchange {
+	uint8_t low;
+	uint8_t high;
 };
 
+/*
+Median selection network for sz inputs, generated at compile time.
+
+Starts from Batcher's odd-even merge sort and then walks it backwards,
+keeping only the comparators that can still move a value onto the middle
+wire. Afterwards the median is at index sz / 2.
+*/
+template<size_t sz>
+struct MedianNetwork {
+	std::array<CompareExchange, sz * sz> steps{};
+	size_t size{0};
+
+	constexpr MedianNetwork() {
+		std::array<CompareExchange, sz * sz> sort{};
+		size_t sort_size{0};
+		for (size_t p = 1; p < sz; p *= 2) {
+			for (size_t k = p; k >= 1; k /= 2) {
+				for (size_t j = k % p; j + k < sz; j += 2 * k) {
+					for (size_t i = 0; i < k && i + j + k < sz; i++) {
+						if ((i + j) / (p * 2) == (i + j + k) / (p * 2)) {
+							sort[sort_size] = CompareExchange{
+								static_cast<uint8_t>(i + j),
+								static_cast<uint8_t>(i + j + k)};
+							sort_size++;
+						}
+					}
+				}
+			}
+		}
+
+		std::array<bool, sz> needed{};
+		std::array<bool, sz * sz> keep{};
+		needed[sz / 2] = true;
+		for (size_t i = sort_size; i > 0; i--) {
+			const CompareExchange step{sort[i - 1]};
+			if (needed[step.low] || needed[step.high]) {
+				keep[i - 1] = true;
+				needed[step.low] = true;
+				needed[step.high] = true;
+			}
+		}
+		for (size_t i = 0; i < sort_size; i++) {
+			if (keep[i]) {
+				steps[size] = sort[i];
+				size++;
+			}
+		}
+	}
+
+	static const MedianNetwork network;
+};
+template<size_t sz>
+constexpr MedianNetwork<sz> MedianNetwork<sz>::network{};
+
+template<typename T>
+inline void compare_exchange(T &low, T &high) {
+	if constexpr (std::is_integral_v<T> && sizeof(T) < sizeof(int32_t)) {
+		// the difference can't overflow, select with a sign mask instead of a branch
+		const int32_t difference{static_cast<int32_t>(low) - static_cast<int32_t>(high)};
+		const int32_t mask{difference >> 31};
+		const int32_t min_offset{difference & ~mask};
+		low = static_cast<T>(low - min_offset);
+		high = static_cast<T>(high + min_offset);
+	} else {
+		const T a{low};
+		const T b{high};
+		low = b < a ? b : a;
+		high = b < a ? a : b;
+	}
+}
+
+template<size_t sz, typename T, size_t... I>
+inline T network_median(std::array<T, sz> &values, std::index_sequence<I...>) {
+	constexpr const auto& network{MedianNetwork<sz>::network};
+	(compare_exchange(values[network.steps[I].low], values[network.steps[I].high]), ...);
+	return values[sz / 2];
+}
+
+template<size_t sz, typename T>
+inline T network_median(std::array<T, sz> &values) {
+	return network_median(values, std::make_index_sequence<MedianNetwork<sz>::network.size>{});
+}
+
+/*
+Median filter over several channels sharing one window, e.g. the x, y and z
+axes of the accelerometer. Windows up to MAX_NETWORK_MEDIAN_SIZE use the
+selection network, larger ones fall back to one MedianFilter per channel.
+
+Invariants: sz is odd
+*/
+template<size_t channels, size_t sz, typename T = int16_t, bool use_network = (sz <= MAX_NETWORK_MEDIAN_SIZE)>
+class MultiChannelMedianFilter;
+
+template<size_t channels, size_t sz, typename T>
+class MultiChannelMedianFilter<channels, sz, T, true> {
+public:
+	using element_t = T;
+	using Sample = std::array<T, channels>;
+
+	MultiChannelMedianFilter() {
+		static_assert(sz % 2 != 0, "the window size must be odd");
+	}
+	~MultiChannelMedianFilter()=default;
+
+	MultiChannelMedianFilter(const MultiChannelMedianFilter&)=delete;
+	MultiChannelMedianFilter(const MultiChannelMedianFilter&&)=delete;
+	MultiChannelMedianFilter& operator=(const MultiChannelMedianFilter&)=delete;
+	MultiChannelMedianFilter& operator=(const MultiChannelMedianFilter&&)=delete;
+
+	void update(const Sample &sample) {
+		_window[_oldest] = sample;
+		_oldest = (_oldest + 1) % sz;
+		if (_count < sz) {
+			_count++;
+		}
+	}
+	// With an even number of values, while the window fills, this is the upper median.
+	Sample get_median() const {
+		Sample median{};
+		std::array<T, sz> column{};
+		for (size_t channel = 0; channel < channels; channel++) {
+			for (size_t i = 0; i < _count; i++) {
+				column[i] = _window[i][channel];
+			}
+			if (_count == sz) {
+				median[channel] = network_median(column);
+			} else {
+				const size_t middle{_count / 2};
+				std::nth_element(column.begin(), column.begin() + middle, column.begin() + _count);
+				median[channel] = column[middle];
+			}
+		}
+		return median;
+	}
+private:
+	std::array<Sample, sz> _window{};
+	size_t _oldest{0};
+	size_t _count{0};
+};
+
+template<size_t channels, size_t sz, typename T>
+class MultiChannelMedianFilter<channels, sz, T, false> {
+public:
+	using element_t = T;
+	using Sample = std::array<T, channels>;
+
+	MultiChannelMedianFilter()=default;
+	~MultiChannelMedianFilter()=default;
+
+	MultiChannelMedianFilter(const MultiChannelMedianFilter&)=delete;
+	MultiChannelMedianFilter(const MultiChannelMedianFilter&&)=delete;
+	MultiChannelMedianFilter& operator=(const MultiChannelMedianFilter&)=delete;
+	MultiChannelMedianFilter& operator=(const MultiChannelMedianFilter&&)=delete;
+
+	void update(const Sample &sample) {
+		for (size_t channel = 0; channel < channels; channel++) {
+			_filters[channel].update(sample[channel]);
+		}
+	}
+	Sample get_median() const {
+		Sample median{};
+		for (size_t channel = 0; channel < channels; channel++) {
+			median[channel] = _filters[channel].get_median();
+		}
+		return median;
+	}
+private:
+	std::array<MedianFilter<sz, T>, channels> _filters;
+};
+
+template<size_t sz, typename T = int16_t>
+using MedianFilter3 = MultiChannelMedianFilter<3, sz, T>;
+
 #endif
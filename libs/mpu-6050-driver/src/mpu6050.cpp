@@ -5,9 +5,13 @@
 
 #include "mpu6050.hpp"
 
+#include <algorithm> // any_of, copy, count_if, min
+
 #include "pico/stdlib.h"
+#include "hardware/dma.h"
 #include "hardware/i2c.h"
 #include "hardware/irq.h"
+#include "hardware/sync.h"
 
 using std::array;
 using std::optional;
@@ -16,19 +20,109 @@ using std::tuple;
 using Values = tuple<array<int16_t, 3>, array<int16_t, 3>, int16_t>;
 using ScaledValues = tuple<array<float, 3>, array<float, 3>, float>;
 
-array<MPU6050*, 2> MPU6050::instances = {nullptr, nullptr};
+array<MPU6050*, MAX_INSTANCES> MPU6050::instances{};
+array<MPU6050*, NUM_BANK0_GPIOS> MPU6050::pin_instances{};
+volatile uint32_t MPU6050::ready_instances{0};
+uint32_t MPU6050::async_instance_count{0};
+
+// Guards the instance tables, the ready mask and the async count. Disabling
+// interrupts only keeps out this core, the gpio irq and the pipeline run on
+// either core and the M0+ has no atomic read-modify-write.
+static spin_lock_t* instance_lock() {
+	// claimed by the first constructor, before any irq can use it
+	static spin_lock_t* const lock{spin_lock_init(spin_lock_claim_unused(true))};
+	return lock;
+}
 
-void mpu6050_callback0(uint _gpio, uint32_t _event) { 
-	MPU6050::instances[0]->_data_available = true;
+void mpu6050_gpio_callback(uint gpio, uint32_t _events) {
+	if (gpio >= NUM_BANK0_GPIOS) {
+		return;
+	}
+	spin_lock_t* lock{instance_lock()};
+	const uint32_t interrupts{spin_lock_blocking(lock)};
+	MPU6050* mpu{MPU6050::pin_instances[gpio]};
+	if (mpu != nullptr) {
+		MPU6050::ready_instances = MPU6050::ready_instances | (1U << mpu->_instance_id);
+	}
+	spin_unlock(lock, interrupts);
+	if (mpu == nullptr) {
+		return;
+	}
+	if (mpu->_async_enabled) {
+		if (!mpu->start_async_read()) {
+			mpu->_missed_interrupt_count = mpu->_missed_interrupt_count + 1;
+		}
+	} else {
+		if (mpu->_data_available) {
+			mpu->_missed_interrupt_count = mpu->_missed_interrupt_count + 1;
+		}
+		mpu->_interrupt_timestamp_us = time_us_32();
+		mpu->_data_available = true;
+	}
 }
-void mpu6050_callback1(uint _gpio, uint32_t _event) {
-	MPU6050::instances[1]->_data_available = true;
+void mpu6050_dma_irq_handler() {
+	for (auto* instance : MPU6050::instances) {
+		if (instance != nullptr
+			&& instance->_async_enabled
+			&& dma_channel_get_irq0_status(instance->_dma_rx_channel))
+		{
+			dma_channel_acknowledge_irq0(instance->_dma_rx_channel);
+			instance->on_async_read_complete();
+		}
+	}
 }
 
-std::array<void (*)(uint gpio, uint32_t event), 2> MPU6050::callbacks = {
-	mpu6050_callback0,
-	mpu6050_callback1
-};
+bool MPU6050::register_instance(MPU6050* mpu) {
+	const uint8_t pin{mpu->_interrupt_pin_number};
+	if (pin >= NUM_BANK0_GPIOS) {
+		return false;
+	}
+	spin_lock_t* lock{instance_lock()};
+	const uint32_t interrupts{spin_lock_blocking(lock)};
+	bool registered{false};
+	if (pin_instances[pin] == nullptr) {
+		for (uint32_t i = 0; i < MAX_INSTANCES; i++) {
+			if (instances[i] == nullptr) {
+				mpu->_instance_id = i;
+				instances[i] = mpu;
+				pin_instances[pin] = mpu;
+				registered = true;
+				break;
+			}
+		}
+	}
+	spin_unlock(lock, interrupts);
+	return registered;
+}
+void MPU6050::unregister_instance(MPU6050* mpu) {
+	const uint32_t id{mpu->_instance_id};
+	if (id == INVALID_INSTANCE_ID) {
+		return;
+	}
+	spin_lock_t* lock{instance_lock()};
+	const uint32_t interrupts{spin_lock_blocking(lock)};
+	instances[id] = nullptr;
+	pin_instances[mpu->_interrupt_pin_number] = nullptr;
+	ready_instances = ready_instances & ~(1U << id);
+	mpu->_instance_id = INVALID_INSTANCE_ID;
+	spin_unlock(lock, interrupts);
+}
+size_t MPU6050::instance_count() {
+	spin_lock_t* lock{instance_lock()};
+	const uint32_t interrupts{spin_lock_blocking(lock)};
+	const size_t count = std::count_if(instances.begin(), instances.end(),
+		[](const MPU6050* mpu) { return mpu != nullptr; });
+	spin_unlock(lock, interrupts);
+	return count;
+}
+uint32_t MPU6050::take_ready_instances() {
+	spin_lock_t* lock{instance_lock()};
+	const uint32_t interrupts{spin_lock_blocking(lock)};
+	const uint32_t ready{ready_instances};
+	ready_instances = 0;
+	spin_unlock(lock, interrupts);
+	return ready;
+}
 
 MPU6050::MPU6050(
 	i2c_inst_t* i2c,
@@ -46,42 +140,68 @@ MPU6050::MPU6050(
 
 	, _accel_full_scale_select{accel_fs}
 	, _accel_scale_factor{accelerometer_scale_factor(accel_fs)}
+	, _accel_scale_reciprocal{1.0F / _accel_scale_factor}
 
 	, _gyro_full_scale_select{gyro_fs}
 	, _gyro_scale_factor{gyroscope_scale_factor(gyro_fs)}
+	, _gyro_scale_reciprocal{1.0F / _gyro_scale_factor}
 
 	, _interrupt_pin_number{interrupt_pin_number}
 {
-	for (uint32_t i = 0; i < 2; i++) {
-		if (instances[i] == nullptr) {
-			_instance_id = i;
-			instances[i] = this;
-			break;
-		}
+	// the interrupt pin is in use or MPU6050_MAX_INSTANCES is too small,
+	// ok() stays false
+	if (!register_instance(this)) {
+		return;
 	}
 
-	start();
+	const bool started{resync_registers() && start()};
 	init_pin_interrupt();
-	fast_calibrate();
+	_ok = started && fast_calibrate();
+	// calibration reads are not samples
+	_sample_ring.clear();
 }
 MPU6050::~MPU6050() {
+	disable_async();
 	deinit_pin_interrupt();
-	MPU6050::instances[_instance_id] = nullptr;
+	unregister_instance(this);
+}
+
+bool MPU6050::ok() const {
+	return _ok;
 }
 
-void MPU6050::reset_device() const {
+bool MPU6050::reset_device() {
 	write_byte(Register::PWR_MGMT_1,
 		static_cast<uint8_t>(PWR_MGMT_1::RESET_BIT));
-	sleep_ms(100);
+
+	// the reset bit clears itself once the device is back up,
+	// reads are nacked until then
+	const absolute_time_t timeout{make_timeout_time_us(RESET_TIMEOUT_US)};
+	bool reset_complete{false};
+	while (!reset_complete && !time_reached(timeout)) {
+		uint8_t power_management{0};
+		reset_complete = read_bytes(Register::PWR_MGMT_1, &power_management, 1)
+			&& (power_management & static_cast<uint8_t>(PWR_MGMT_1::RESET_BIT)) == 0;
+	}
+
 	write_byte(Register::SIGNAL_PATH_RESET,
 		static_cast<uint8_t>(SIGNAL_PATH_RESET::RESET_ALL));
+	// every register is back to its power on value
+	return resync_registers() && reset_complete;
 }
 void MPU6050::callibrate() {
 
 }
-void MPU6050::fast_calibrate() {
+bool MPU6050::fast_calibrate() {
+	// a sensor that is still waking up reads back zeros
+	const absolute_time_t timeout{make_timeout_time_us(CALIBRATION_TIMEOUT_US)};
 	while (true) {
-		read_data_from_device();
+		if (time_reached(timeout)) {
+			return false;
+		}
+		if (!read_data_from_device()) {
+			continue;
+		}
 		const auto [accel, gyro, _] = get_raw_values();
 
 		uint8_t zero_count = 0;
@@ -98,43 +218,69 @@ void MPU6050::fast_calibrate() {
 		}
 	}
 
-	sleep_ms(10);
-	read_data_from_device();
+	// two sample periods
+	if (!wait_for_data_ready(2000000 / _sample_rate_hz) || !read_data_from_device()) {
+		return false;
+	}
 	auto [accel, gyro, _] = get_raw_values();
 
 	accel[2] -= _accel_scale_factor;
 	const auto accel_offset = calc_accel_offset_register_values(accel);
-	update_accel_offset_registers(accel_offset);
 	const auto gyro_offset = calc_gyro_offset_register_values(gyro);
-	update_gyro_offset_registers(gyro_offset);
+	return update_accel_offset_registers(accel_offset)
+		&& update_gyro_offset_registers(gyro_offset);
 }
 
-void MPU6050::start() {
-	write_byte(Register::PWR_MGMT_2, 0);
-	write_byte(Register::PWR_MGMT_1, static_cast<uint8_t>(_clock_source));
-
-	write_byte(Register::ACCEL_CONFIG, static_cast<uint8_t>(_accel_full_scale_select));
-	write_byte(Register::GYRO_CONFIG, static_cast<uint8_t>(_gyro_full_scale_select));
-
-
-	const auto dlpf_value{static_cast<uint8_t>(_dlpf_bandwidth)};
-	write_byte(Register::CONFIG, dlpf_value);
-
-	// smplrt_div
-	//   sample rate = gyroscope_output_rate / (1 + SMPLRT_DIV)
-	//   gyroscope_output_rate = 8kHz when DLPF is disabled (DLPF_CFG = 0 or 7)
-	//   gyroscope_output_rate = 1KHz when DLPF is enabled
-	const uint16_t gyro_sample_rate = (dlpf_value == 0 || dlpf_value == 7) ? 8000 : 1000;
-	const uint8_t smplrt = gyro_sample_rate / _sample_rate_hz - 1;
-	write_byte(Register::SMPLRT_DIV, smplrt);
+bool MPU6050::start() {
+	// PWR_MGMT_1 and PWR_MGMT_2 are adjacent
+	const array<uint8_t, 2> power_management = {static_cast<uint8_t>(_clock_source), 0};
+	if (!write_bytes(Register::PWR_MGMT_1, &power_management[0], power_management.size())) {
+		return false;
+	}
+	return apply_configuration();
+}
+bool MPU6050::apply_configuration() const {
+	const auto values{configuration_register_values()};
+	if (!write_bytes(Register::SMPLRT_DIV, &values[0], values.size())) {
+		return false;
+	}
+	auto read_back = array<uint8_t, 4>{0, 0, 0, 0};
+	return read_bytes(Register::SMPLRT_DIV, &read_back[0], read_back.size())
+		&& read_back == values;
+}
+bool MPU6050::wait_for_data_ready(uint32_t timeout_us) const {
+	const absolute_time_t timeout{make_timeout_time_us(timeout_us)};
+	do {
+		uint8_t status{0};
+		if (read_bytes(Register::INT_STATUS, &status, 1)
+			&& (status & static_cast<uint8_t>(INTERRUPT_STATUS::DATA_READY_BIT)) != 0)
+		{
+			return true;
+		}
+	} while (!time_reached(timeout));
+	return false;
 }
-void MPU6050::init_pin_interrupt() const {
-	gpio_set_irq_enabled_with_callback(_interrupt_pin_number, GPIO_IRQ_EDGE_RISE, true, MPU6050::callbacks[_instance_id]);
-	write_byte(Register::INT_ENABLE,
-		static_cast<uint8_t>(INTERRUPT_ENABLE::DATA_READY_ENABLE_BIT));
+void MPU6050::init_pin_interrupt() {
+	if (_instance_id == INVALID_INSTANCE_ID) {
+		return;
+	}
+	// every instance shares one dispatcher, the sdk only keeps one gpio callback per core
+	gpio_set_irq_enabled_with_callback(_interrupt_pin_number, GPIO_IRQ_EDGE_RISE, true, mpu6050_gpio_callback);
+	// keeps the fifo overflow enable if the fifo is running
+	set_interrupt_enabled(INTERRUPT_ENABLE::DATA_READY_ENABLE_BIT, true);
 }
 void MPU6050::deinit_pin_interrupt() const {
-	irq_set_enabled(_interrupt_pin_number, false);
+	// the pin may belong to another instance
+	if (_instance_id == INVALID_INSTANCE_ID) {
+		return;
+	}
+	gpio_set_irq_enabled(_interrupt_pin_number, GPIO_IRQ_EDGE_RISE, false);
+}
+uint32_t MPU6050::instance_id() const {
+	return _instance_id;
+}
+uint32_t MPU6050::sample_rate() const {
+	return _sample_rate_hz;
 }
 
 uint8_t MPU6050::read_byte(Register reg) const {
@@ -145,38 +291,444 @@ uint8_t MPU6050::read_byte(Register reg) const {
 	i2c_read_blocking(_i2c, address, &byte, 1, false);
 	return byte;
 }
+bool MPU6050::read_bytes(Register reg, uint8_t* buffer, size_t length) const {
+	const auto address{static_cast<uint8_t>(_address)};
+	const auto read_register{static_cast<uint8_t>(reg)};
+	i2c_write_blocking(_i2c, address, &read_register, 1, true);
+	const int32_t read_count = i2c_read_blocking(_i2c, address, buffer, length, false);
+	return read_count == static_cast<int32_t>(length);
+}
 void MPU6050::write_byte(Register reg, uint8_t value) const {
 	const auto address{static_cast<uint8_t>(_address)};
 	const array<uint8_t, 2> buffer = {static_cast<uint8_t>(reg), value};
-    i2c_write_blocking(_i2c, address, &buffer[0], 2, true);
-	sleep_ms(10);
+	if (i2c_write_blocking(_i2c, address, &buffer[0], 2, false) == 2) {
+		_registers.store(reg, value);
+	}
+}
+bool MPU6050::write_bytes(Register first_reg, const uint8_t* values, size_t count) const {
+	assert(count <= MAX_BURST_WRITE_BYTES);
+	const auto address{static_cast<uint8_t>(_address)};
+	array<uint8_t, MAX_BURST_WRITE_BYTES + 1> buffer{};
+	buffer[0] = static_cast<uint8_t>(first_reg);
+	std::copy(values, values + count, buffer.begin() + 1);
+	const int32_t write_count = i2c_write_blocking(_i2c, address, &buffer[0], count + 1, false);
+	if (write_count != static_cast<int32_t>(count + 1)) {
+		return false;
+	}
+	for (size_t i = 0; i < count; i++) {
+		_registers.store(static_cast<Register>(static_cast<uint8_t>(first_reg) + i), values[i]);
+	}
+	return true;
+}
+
+
+uint8_t MPU6050::cached_register(Register reg) const {
+	return _registers.get(reg);
+}
+void MPU6050::update_bits(Register reg, uint8_t mask, uint8_t value) {
+	_registers.update_bits(reg, mask, value);
+}
+bool MPU6050::flush_registers() {
+	bool success{true};
+	_registers.for_each_dirty_run(MAX_BURST_WRITE_BYTES, [&](Register first, size_t count) {
+		// copy out, write_bytes stores into the shadow as it goes
+		array<uint8_t, MAX_BURST_WRITE_BYTES> values{};
+		std::copy(_registers.values_from(first), _registers.values_from(first) + count, values.begin());
+		success = write_bytes(first, &values[0], count) && success;
+	});
+	return success;
+}
+bool MPU6050::flush_register(Register reg) {
+	if (!_registers.is_dirty(reg)) {
+		return true;
+	}
+	const uint8_t value{_registers.get(reg)};
+	return write_bytes(reg, &value, 1);
+}
+bool MPU6050::resync_registers() {
+	bool success{true};
+	for (const auto& range : WRITABLE_REGISTER_RANGES) {
+		array<uint8_t, MAX_WRITABLE_RANGE_SIZE> values{};
+		if (!read_bytes(range.first, &values[0], range.size())) {
+			success = false;
+			continue;
+		}
+		for (size_t i = 0; i < range.size(); i++) {
+			_registers.store(static_cast<Register>(static_cast<uint8_t>(range.first) + i), values[i]);
+		}
+	}
+	return success;
+}
+bool MPU6050::verify_registers() const {
+	for (const auto& range : WRITABLE_REGISTER_RANGES) {
+		array<uint8_t, MAX_WRITABLE_RANGE_SIZE> values{};
+		if (!read_bytes(range.first, &values[0], range.size())) {
+			return false;
+		}
+		for (size_t i = 0; i < range.size(); i++) {
+			const auto reg{static_cast<Register>(static_cast<uint8_t>(range.first) + i)};
+			const uint8_t ignored{self_clearing_bits(reg)};
+			if (!_registers.is_dirty(reg)
+				&& (values[i] & ~ignored) != (_registers.get(reg) & ~ignored))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+bool MPU6050::set_sleep_enabled(bool sleep) {
+	const auto sleep_bit{static_cast<uint8_t>(PWR_MGMT_1::SLEEP_BIT)};
+	update_bits(Register::PWR_MGMT_1, sleep_bit, sleep ? sleep_bit : 0);
+	return flush_register(Register::PWR_MGMT_1);
+}
+bool MPU6050::set_clock_source(PWR_MGMT_1 clock_source) {
+	const uint8_t clock_select_mask{(1U << PWR_MGMT_1_CLOCK_SELECT_LENGTH) - 1U};
+	update_bits(Register::PWR_MGMT_1, clock_select_mask << PWR_MGMT_1_CLOCK_SELECT_POSITION,
+		static_cast<uint8_t>(clock_source));
+	if (!flush_register(Register::PWR_MGMT_1)) {
+		return false;
+	}
+	_clock_source = clock_source;
+	return true;
+}
+bool MPU6050::set_interrupt_enabled(INTERRUPT_ENABLE interrupt, bool enabled) {
+	const auto bit{static_cast<uint8_t>(interrupt)};
+	update_bits(Register::INT_ENABLE, bit, enabled ? bit : 0);
+	return flush_register(Register::INT_ENABLE);
 }
 
 bool MPU6050::available() const {
 	return _data_available;
 }
 bool MPU6050::read_data_from_device() {
-	uint8_t addr = static_cast<uint8_t>(_address);
-	uint8_t reg = static_cast<uint8_t>(Register::ACCEL_XOUT_H);
-    i2c_write_blocking(_i2c, addr, &reg, 1, true);
-	int32_t read_count = i2c_read_blocking(_i2c, addr, &_buffer[0], 14, false);
+	// stamped with its data ready interrupt when one announced it
+	const uint32_t timestamp_us{_data_available ? _interrupt_timestamp_us : time_us_32()};
+	const bool success{read_bytes(Register::ACCEL_XOUT_H, &_buffer[0], RAW_DATA_SIZE_BYTES)};
 	_data_available = false;
-	return read_count == 14;
+	if (success) {
+		queue_sample(timestamp_us, &_buffer[0], true);
+	}
+	return success;
 }
-Values MPU6050::get_raw_values() {
-	auto values = Values {
-		{
-			static_cast<int16_t>(_buffer[0] << 8 | _buffer[1]),
-			static_cast<int16_t>(_buffer[2] << 8 | _buffer[3]),
-			static_cast<int16_t>(_buffer[4] << 8 | _buffer[5])
-		},
-		{
-			static_cast<int16_t>(_buffer[8]  << 8 | _buffer[9]),
-			static_cast<int16_t>(_buffer[10] << 8 | _buffer[11]),
-			static_cast<int16_t>(_buffer[12] << 8 | _buffer[13])
-		},
-		static_cast<int16_t>(_buffer[6] << 8 | _buffer[7])
+
+bool MPU6050::enable_fifo(bool include_temperature) {
+	auto sources = static_cast<uint8_t>(FIFO_ENABLE::XG_FIFO_EN_BIT)
+		| static_cast<uint8_t>(FIFO_ENABLE::YG_FIFO_EN_BIT)
+		| static_cast<uint8_t>(FIFO_ENABLE::ZG_FIFO_EN_BIT)
+		| static_cast<uint8_t>(FIFO_ENABLE::ACCEL_FIFO_EN_BIT);
+	if (include_temperature) {
+		sources |= static_cast<uint8_t>(FIFO_ENABLE::TEMP_FIFO_EN_BIT);
+	}
+	_fifo_frame_size = include_temperature ? FIFO_FRAME_WITH_TEMP_SIZE_BYTES : FIFO_FRAME_SIZE_BYTES;
+
+	// stop and empty the fifo before changing what gets written to it,
+	// only the fifo bits change, the i2c master and slave bits are kept
+	bool success{reset_fifo_buffer()};
+	update_bits(Register::FIFO_EN, FIFO_SENSOR_BITS, sources);
+	update_bits(Register::INT_ENABLE, FIFO_INTERRUPT_BITS, FIFO_INTERRUPT_BITS);
+	success = flush_register(Register::FIFO_EN) && success;
+	success = flush_register(Register::INT_ENABLE) && success;
+	// clear a stale overflow flag
+	read_byte(Register::INT_STATUS);
+	update_bits(Register::USER_CTRL, FIFO_CONTROL_BITS, static_cast<uint8_t>(USER_CTRL::FIFO_EN_BIT));
+	success = flush_register(Register::USER_CTRL) && success;
+	_fifo_enabled = success;
+	return success;
+}
+bool MPU6050::disable_fifo() {
+	bool success{reset_fifo_buffer()};
+	update_bits(Register::FIFO_EN, FIFO_SENSOR_BITS, 0);
+	update_bits(Register::INT_ENABLE, static_cast<uint8_t>(INTERRUPT_ENABLE::FIFO_OVERFLOW_ENABLE_BIT), 0);
+	success = flush_register(Register::FIFO_EN) && success;
+	success = flush_register(Register::INT_ENABLE) && success;
+	_fifo_enabled = false;
+	return success;
+}
+bool MPU6050::reset_fifo() {
+	bool success{reset_fifo_buffer()};
+	if (_fifo_enabled) {
+		update_bits(Register::USER_CTRL, FIFO_CONTROL_BITS, static_cast<uint8_t>(USER_CTRL::FIFO_EN_BIT));
+		success = flush_register(Register::USER_CTRL) && success;
+	}
+	return success;
+}
+bool MPU6050::reset_fifo_buffer() {
+	// FIFO_RESET only takes effect while FIFO_EN is cleared, the shadow
+	// treats it as self clearing so it is written once and not kept
+	update_bits(Register::USER_CTRL, FIFO_CONTROL_BITS, static_cast<uint8_t>(USER_CTRL::FIFO_RESET_BIT));
+	return flush_register(Register::USER_CTRL);
+}
+bool MPU6050::fifo_enabled() const {
+	return _fifo_enabled;
+}
+size_t MPU6050::fifo_frame_size() const {
+	return _fifo_frame_size;
+}
+uint16_t MPU6050::read_fifo_count() const {
+	auto count = array<uint8_t, 2>{0, 0};
+	if (!read_bytes(Register::FIFO_COUNTH, &count[0], 2)) {
+		return 0;
+	}
+	return static_cast<uint16_t>(count[0] << 8 | count[1]);
+}
+size_t MPU6050::read_fifo(uint8_t* buffer, size_t max_frames) {
+	_data_available = false;
+	if (!_fifo_enabled) {
+		return 0;
+	}
+
+	// Once the fifo overflows the oldest bytes are overwritten and the
+	// remaining data is no longer aligned to frame boundaries.
+	const auto status{read_byte(Register::INT_STATUS)};
+	if ((status & static_cast<uint8_t>(INTERRUPT_STATUS::FIFO_OVERFLOW_BIT)) != 0) {
+		reset_fifo();
+		_fifo_overflow_count++;
+		return 0;
+	}
+
+	const uint32_t read_time_us{time_us_32()};
+	const size_t queued_frames{read_fifo_count() / _fifo_frame_size};
+	const size_t frame_count{std::min(queued_frames, max_frames)};
+	if (frame_count == 0) {
+		return 0;
+	}
+
+	// FIFO_R_W does not auto increment so the whole burst comes out of the fifo
+	if (!read_bytes(Register::FIFO_R_W, buffer, frame_count * _fifo_frame_size)) {
+		reset_fifo();
+		return 0;
+	}
+
+	// the newest queued frame is about as old as the read, the ones before
+	// it a sample period apart
+	const uint32_t sample_period_us{1000000U / _sample_rate_hz};
+	const bool includes_temperature{_fifo_frame_size == FIFO_FRAME_WITH_TEMP_SIZE_BYTES};
+	for (size_t i = 0; i < frame_count; i++) {
+		const auto frames_after{static_cast<uint32_t>(queued_frames - 1 - i)};
+		queue_sample(read_time_us - frames_after * sample_period_us,
+			buffer + i * _fifo_frame_size, includes_temperature);
+	}
+	return frame_count;
+}
+uint32_t MPU6050::fifo_overflow_count() const {
+	return _fifo_overflow_count;
+}
+Values MPU6050::decode_fifo_frame(const uint8_t* frame) const {
+	return decode_raw_values(frame, _fifo_frame_size == FIFO_FRAME_WITH_TEMP_SIZE_BYTES);
+}
+
+bool MPU6050::enable_async(AsyncReadCallback callback) {
+	if (_async_enabled) {
+		return true;
+	}
+	// completions are dispatched through the instance table
+	if (_instance_id == INVALID_INSTANCE_ID) {
+		return false;
+	}
+	const int32_t tx_channel{dma_claim_unused_channel(false)};
+	const int32_t rx_channel{dma_claim_unused_channel(false)};
+	if (tx_channel < 0 || rx_channel < 0) {
+		if (tx_channel >= 0) {
+			dma_channel_unclaim(tx_channel);
+		}
+		if (rx_channel >= 0) {
+			dma_channel_unclaim(rx_channel);
+		}
+		return false;
+	}
+	_dma_tx_channel = tx_channel;
+	_dma_rx_channel = rx_channel;
+	_async_callback = callback;
+
+	// write the starting register, then restart and clock in every byte,
+	// issuing a stop after the last one
+	_async_commands[0] = static_cast<uint8_t>(Register::INT_STATUS);
+	for (size_t i = 1; i < _async_commands.size(); i++) {
+		_async_commands[i] = I2C_IC_DATA_CMD_CMD_BITS;
+	}
+	_async_commands[1] |= I2C_IC_DATA_CMD_RESTART_BITS;
+	_async_commands[_async_commands.size() - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+	i2c_hw_t* hw{i2c_get_hw(_i2c)};
+	hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+
+	dma_channel_config tx_config{dma_channel_get_default_config(_dma_tx_channel)};
+	channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_32);
+	channel_config_set_read_increment(&tx_config, true);
+	channel_config_set_write_increment(&tx_config, false);
+	channel_config_set_dreq(&tx_config, i2c_get_dreq(_i2c, true));
+	dma_channel_configure(_dma_tx_channel, &tx_config,
+		&hw->data_cmd, &_async_commands[0], _async_commands.size(), false);
+
+	dma_channel_config rx_config{dma_channel_get_default_config(_dma_rx_channel)};
+	channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
+	channel_config_set_read_increment(&rx_config, false);
+	channel_config_set_write_increment(&rx_config, true);
+	channel_config_set_dreq(&rx_config, i2c_get_dreq(_i2c, false));
+	dma_channel_configure(_dma_rx_channel, &rx_config,
+		&_async_buffers[0][0], &hw->data_cmd, ASYNC_READ_SIZE_BYTES, false);
+
+	_async_busy = false;
+	_async_complete = false;
+
+	dma_channel_set_irq0_enabled(_dma_rx_channel, true);
+	spin_lock_t* lock{instance_lock()};
+	const uint32_t interrupts{spin_lock_blocking(lock)};
+	// the transfer retargets the bus and its abort flag is shared, a
+	// second device's read would cut this one's off
+	const bool bus_free{!async_i2c_in_use(_i2c)};
+	if (bus_free) {
+		// one handler serves every device, it is added by the first one
+		if (async_instance_count == 0) {
+			irq_add_shared_handler(DMA_IRQ_0, mpu6050_dma_irq_handler,
+				PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+		}
+		async_instance_count++;
+		_async_enabled = true;
+	}
+	spin_unlock(lock, interrupts);
+	if (!bus_free) {
+		dma_channel_set_irq0_enabled(_dma_rx_channel, false);
+		dma_channel_unclaim(_dma_tx_channel);
+		dma_channel_unclaim(_dma_rx_channel);
+		return false;
+	}
+	irq_set_enabled(DMA_IRQ_0, true);
+	return true;
+}
+void MPU6050::disable_async() {
+	if (!_async_enabled) {
+		return;
+	}
+	// keep the gpio irq from starting another read
+	_async_enabled = false;
+	dma_channel_set_irq0_enabled(_dma_rx_channel, false);
+	dma_channel_abort(_dma_tx_channel);
+	dma_channel_abort(_dma_rx_channel);
+	dma_channel_acknowledge_irq0(_dma_rx_channel);
+	spin_lock_t* lock{instance_lock()};
+	const uint32_t interrupts{spin_lock_blocking(lock)};
+	// the last device out removes the handler
+	async_instance_count--;
+	if (async_instance_count == 0) {
+		irq_remove_handler(DMA_IRQ_0, mpu6050_dma_irq_handler);
+	}
+	spin_unlock(lock, interrupts);
+	dma_channel_unclaim(_dma_tx_channel);
+	dma_channel_unclaim(_dma_rx_channel);
+	_async_busy = false;
+}
+bool MPU6050::async_i2c_in_use(const i2c_inst_t* i2c) {
+	return std::any_of(instances.begin(), instances.end(), [i2c](const MPU6050* mpu) {
+		return mpu != nullptr && mpu->_async_enabled && mpu->_i2c == i2c;
+	});
+}
+bool MPU6050::async_enabled() const {
+	return _async_enabled;
+}
+bool MPU6050::start_async_read() {
+	i2c_hw_t* hw{i2c_get_hw(_i2c)};
+	if (_async_busy) {
+		// a nack aborts the transfer and the rx channel never finishes
+		if ((hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) == 0U) {
+			return false;
+		}
+		dma_channel_abort(_dma_tx_channel);
+		dma_channel_abort(_dma_rx_channel);
+		static_cast<void>(hw->clr_tx_abrt);
+		_async_error_count++;
+	}
+	_async_busy = true;
+	_async_timestamp_us = time_us_32();
+
+	hw->enable = 0;
+	hw->tar = static_cast<uint8_t>(_address);
+	hw->enable = 1;
+
+	dma_channel_set_write_addr(_dma_rx_channel, &_async_buffers[_async_write_index][0], false);
+	dma_channel_set_trans_count(_dma_rx_channel, ASYNC_READ_SIZE_BYTES, false);
+	dma_channel_set_read_addr(_dma_tx_channel, &_async_commands[0], false);
+	dma_channel_set_trans_count(_dma_tx_channel, _async_commands.size(), false);
+	dma_start_channel_mask((1U << _dma_rx_channel) | (1U << _dma_tx_channel));
+	return true;
+}
+bool MPU6050::async_read_complete() const {
+	return _async_complete;
+}
+uint8_t MPU6050::consume_async_read() {
+	// keep a new transfer from being started into the buffer being copied
+	const uint32_t interrupts{save_and_disable_interrupts()};
+	const auto& buffer{_async_buffers[_async_read_index]};
+	std::copy(buffer.begin() + 1, buffer.end(), _buffer.begin());
+	const uint8_t status{buffer[0]};
+	_async_complete = false;
+	_data_available = false;
+	restore_interrupts(interrupts);
+	return status;
+}
+uint32_t MPU6050::async_error_count() const {
+	return _async_error_count;
+}
+uint32_t MPU6050::last_async_read_us() const {
+	return _async_read_us;
+}
+bool MPU6050::pop_sample(RawSample* sample) {
+	return _sample_ring.pop(sample);
+}
+size_t MPU6050::samples_pending() const {
+	return _sample_ring.size();
+}
+uint32_t MPU6050::sample_overrun_count() const {
+	return _sample_ring.overrun_count();
+}
+uint32_t MPU6050::missed_interrupt_count() const {
+	return _missed_interrupt_count;
+}
+void MPU6050::queue_sample(uint32_t timestamp_us, const uint8_t* frame, bool includes_temperature) {
+	// queued samples always have the register layout, the temperature of
+	// fifo frames without one reads as zero
+	RawSample sample{timestamp_us, {}};
+	std::copy(frame, frame + 6, sample.data.begin());
+	if (includes_temperature) {
+		std::copy(frame + 6, frame + 8, sample.data.begin() + 6);
+	}
+	const uint8_t* gyro{includes_temperature ? frame + 8 : frame + 6};
+	std::copy(gyro, gyro + 6, sample.data.begin() + 8);
+	_sample_ring.push(sample);
+}
+Values MPU6050::decode_sample(const RawSample& sample) {
+	return decode_raw_values(sample.data.data(), true);
+}
+void MPU6050::on_async_read_complete() {
+	const auto& buffer{_async_buffers[_async_write_index]};
+	_async_read_us = time_us_32() - _async_timestamp_us;
+	queue_sample(_async_timestamp_us, &buffer[1], true);
+
+	_async_read_index = _async_write_index;
+	_async_write_index = _async_write_index ^ 1U;
+	_async_busy = false;
+	_async_complete = true;
+	_data_available = true;
+	if (_async_callback != nullptr) {
+		_async_callback(this);
+	}
+}
+
+RawFrameView MPU6050::fifo_frames(const uint8_t* buffer, size_t frame_count) const {
+	return RawFrameView(buffer, frame_count, _fifo_frame_size == FIFO_FRAME_WITH_TEMP_SIZE_BYTES);
+}
+
+Values MPU6050::decode_raw_values(const uint8_t* frame, bool includes_temperature) {
+	const RawFrameView view(frame, 1, includes_temperature);
+	return Values {
+		{view.accel(0, 0), view.accel(0, 1), view.accel(0, 2)},
+		{view.gyro(0, 0), view.gyro(0, 1), view.gyro(0, 2)},
+		view.temperature(0)
 	};
+}
+Values MPU6050::get_raw_values() {
+	auto values{decode_raw_values(&_buffer[0], true)};
 	_data_available = false;
 	return values;
 }
@@ -185,7 +737,19 @@ tuple<array<int16_t, 3>, array<float, 3> > MPU6050::get_offset_accel_and_scaled_
 
 	auto gyro_scaled = array<float, 3>{0, 0, 0};
 	for (uint32_t i = 0; i < 3; i++) {
-		gyro_scaled[i] = static_cast<float>(gyro[i]) / _gyro_scale_factor;
+		gyro_scaled[i] = static_cast<float>(gyro[i]) * _gyro_scale_reciprocal;
+	}
+	return {
+		accel,
+		gyro_scaled
+	};
+}
+tuple<array<int16_t, 3>, array<float, 3> > MPU6050::get_offset_accel_and_scaled_gyros(const RawSample& sample) const {
+	auto [accel, gyro, temp] = decode_sample(sample);
+
+	auto gyro_scaled = array<float, 3>{0, 0, 0};
+	for (uint32_t i = 0; i < 3; i++) {
+		gyro_scaled[i] = static_cast<float>(gyro[i]) * _gyro_scale_reciprocal;
 	}
 	return {
 		accel,
@@ -198,11 +762,11 @@ ScaledValues MPU6050::get_scaled_values() {
 	auto accel_scaled = array<float, 3>{0, 0, 0};
 	auto gyro_scaled = array<float, 3>{0, 0, 0};
 	for (uint32_t i = 0; i < 3; i++) {
-		accel_scaled[i] = static_cast<float>(accel[i]) / _accel_scale_factor;
-		gyro_scaled[i] = static_cast<float>(gyro[i]) / _gyro_scale_factor;
+		accel_scaled[i] = static_cast<float>(accel[i]) * _accel_scale_reciprocal;
+		gyro_scaled[i] = static_cast<float>(gyro[i]) * _gyro_scale_reciprocal;
 	}
 
-	const auto temp_scaled{static_cast<float>(temp) / 340.0f + 36.53f};
+	const auto temp_scaled{static_cast<float>(temp) * TEMPERATURE_SCALE_RECIPROCAL + TEMPERATURE_OFFSET};
 
 	return {accel_scaled, gyro_scaled, temp_scaled};
 }
@@ -274,19 +838,21 @@ array<uint8_t, 6> MPU6050::calc_gyro_offset_register_values(const array<int16_t,
 	};
 }
 
-void MPU6050::update_accel_offset_registers(const array<uint8_t, 6> &offset_register_values) const {
-	write_byte(Register::XA_OFFS_USRH, offset_register_values[0]);
-	write_byte(Register::XA_OFFS_USRL, offset_register_values[1]);
-	write_byte(Register::YA_OFFS_USRH, offset_register_values[2]);
-	write_byte(Register::YA_OFFS_USRL, offset_register_values[3]);
-	write_byte(Register::ZA_OFFS_USRH, offset_register_values[4]);
-	write_byte(Register::ZA_OFFS_USRL, offset_register_values[5]);
-}
-void MPU6050::update_gyro_offset_registers(const array<uint8_t, 6> &offset_register_values) const {
-	write_byte(Register::XG_OFFS_USRH, offset_register_values[0]);
-	write_byte(Register::XG_OFFS_USRL, offset_register_values[1]);
-	write_byte(Register::YG_OFFS_USRH, offset_register_values[2]);
-	write_byte(Register::YG_OFFS_USRL, offset_register_values[3]);
-	write_byte(Register::ZG_OFFS_USRH, offset_register_values[4]);
-	write_byte(Register::ZG_OFFS_USRL, offset_register_values[5]);
+array<uint8_t, 4> MPU6050::configuration_register_values() const {
+	// SMPLRT_DIV, CONFIG, GYRO_CONFIG, ACCEL_CONFIG
+	return {
+		sample_rate_divider(_dlpf_bandwidth, _sample_rate_hz),
+		static_cast<uint8_t>(_dlpf_bandwidth),
+		static_cast<uint8_t>(_gyro_full_scale_select),
+		static_cast<uint8_t>(_accel_full_scale_select)
+	};
+}
+
+bool MPU6050::update_accel_offset_registers(const array<uint8_t, 6> &offset_register_values) const {
+	// XA_OFFS_USRH..ZA_OFFS_USRL
+	return write_bytes(Register::XA_OFFS_USRH, &offset_register_values[0], offset_register_values.size());
+}
+bool MPU6050::update_gyro_offset_registers(const array<uint8_t, 6> &offset_register_values) const {
+	// XG_OFFS_USRH..ZG_OFFS_USRL
+	return write_bytes(Register::XG_OFFS_USRH, &offset_register_values[0], offset_register_values.size());
 }
\ No newline at end of file
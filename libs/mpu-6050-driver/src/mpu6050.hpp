@@ -16,12 +16,55 @@
 #include <optional>
 #include <tuple>
 
+#include "hardware/gpio.h"
 #include "hardware/i2c.h"
 
 #include "mpu6050_config.hpp"
+#include "register_shadow.hpp"
+#include "sample_batch.hpp"
+#include "spsc_ring.hpp"
+
+// Number of devices that can be registered at once. Override with a compile
+// definition, e.g. target_compile_definitions(app PRIVATE MPU6050_MAX_INSTANCES=8)
+#ifndef MPU6050_MAX_INSTANCES
+#define MPU6050_MAX_INSTANCES 4
+#endif
+
+// Samples buffered per device between drains, must be a power of two.
+#ifndef MPU6050_SAMPLE_RING_CAPACITY
+#define MPU6050_SAMPLE_RING_CAPACITY 32
+#endif
+
+constexpr size_t MAX_INSTANCES{MPU6050_MAX_INSTANCES};
+constexpr size_t SAMPLE_RING_CAPACITY{MPU6050_SAMPLE_RING_CAPACITY};
+static_assert(MAX_INSTANCES > 0 && MAX_INSTANCES <= 32, "the ready mask holds one bit per instance");
+constexpr uint32_t INVALID_INSTANCE_ID{UINT32_MAX};
 
 constexpr i2c_inst_t* DEFAULT_I2C_INSTANCE{i2c0};
-constexpr size_t RAW_DATA_SIZE_BYTES{14};
+constexpr size_t RAW_DATA_SIZE_BYTES{RAW_FRAME_SIZE_BYTES};
+// INT_STATUS followed by the sample block, 0x3A-0x48
+constexpr size_t ASYNC_READ_SIZE_BYTES{RAW_DATA_SIZE_BYTES + 1};
+// largest register range written in a single transaction
+constexpr size_t MAX_BURST_WRITE_BYTES{16};
+constexpr uint32_t RESET_TIMEOUT_US{100000};
+// how long fast_calibrate() waits for the sensor to report non zero axes
+constexpr uint32_t CALIBRATION_TIMEOUT_US{500000};
+constexpr size_t FIFO_SIZE_BYTES{1024};
+// accel(6) + gyro(6), or accel(6) + temp(2) + gyro(6) with the temperature enabled
+constexpr size_t FIFO_FRAME_SIZE_BYTES{RAW_FRAME_WITHOUT_TEMP_SIZE_BYTES};
+constexpr size_t FIFO_FRAME_WITH_TEMP_SIZE_BYTES{RAW_FRAME_SIZE_BYTES};
+constexpr size_t FIFO_MAX_FRAMES{FIFO_SIZE_BYTES / FIFO_FRAME_SIZE_BYTES};
+// the bits the fifo functions own in USER_CTRL, FIFO_EN and INT_ENABLE
+constexpr uint8_t FIFO_CONTROL_BITS{static_cast<uint8_t>(USER_CTRL::FIFO_EN_BIT) | static_cast<uint8_t>(USER_CTRL::FIFO_RESET_BIT)};
+constexpr uint8_t FIFO_SENSOR_BITS{
+	static_cast<uint8_t>(FIFO_ENABLE::TEMP_FIFO_EN_BIT)
+	| static_cast<uint8_t>(FIFO_ENABLE::XG_FIFO_EN_BIT)
+	| static_cast<uint8_t>(FIFO_ENABLE::YG_FIFO_EN_BIT)
+	| static_cast<uint8_t>(FIFO_ENABLE::ZG_FIFO_EN_BIT)
+	| static_cast<uint8_t>(FIFO_ENABLE::ACCEL_FIFO_EN_BIT)};
+constexpr uint8_t FIFO_INTERRUPT_BITS{
+	static_cast<uint8_t>(INTERRUPT_ENABLE::DATA_READY_ENABLE_BIT)
+	| static_cast<uint8_t>(INTERRUPT_ENABLE::FIFO_OVERFLOW_ENABLE_BIT)};
 constexpr uint32_t DEFAULT_SAMPLE_RATE_HZ{100};
 constexpr uint32_t MAX_SAMPLE_RATE{8000};
 constexpr PWR_MGMT_1 DEFAULT_CLOCK_SOURCE{PWR_MGMT_1::CLOCK_SELECT_PLL_WITH_X_AXIS_GYRO_REF_BIT};
@@ -30,6 +73,9 @@ constexpr ACCEL_CONFIG DEFAULT_ACCEL_FULL_SCALE_SELECT{ACCEL_CONFIG::FS_SELECT_4
 constexpr GYRO_CONFIG DEFAULT_GYRO_FULL_SCALE_SELECT{GYRO_CONFIG::FS_SELECT_500_DEG_PER_SEC_BIT};
 constexpr int16_t DEFAULT_ACCEL_DEADZONE{4};
 constexpr int16_t DEFAULT_GYRO_DEADZONE{1};
+// degrees C = raw / 340 + 36.53
+constexpr float TEMPERATURE_SCALE_RECIPROCAL{1.0F / 340.0F};
+constexpr float TEMPERATURE_OFFSET{36.53F};
 
 struct MPU6050Config {
 	MPU6050Address _address{MPU6050Address::DEFAULT};
@@ -55,11 +101,21 @@ public:
 	using OffsetAccelScaledGyros = std::tuple<std::array<int16_t, 3>, std::array<float, 3> >;
 	using ScaledValues = std::tuple<std::array<float, 3>, std::array<float, 3>, float>;
 
-	friend void mpu6050_callback0(uint gpio, uint32_t event);
-	friend void mpu6050_callback1(uint gpio, uint32_t event);
+	using AsyncReadCallback = void (*)(MPU6050* mpu);
+
+	friend void mpu6050_gpio_callback(uint gpio, uint32_t events);
+	friend void mpu6050_dma_irq_handler();
+
+	static std::array<MPU6050*, MAX_INSTANCES> instances;
+	// interrupt pin -> instance, used by the gpio irq dispatcher
+	static std::array<MPU6050*, NUM_BANK0_GPIOS> pin_instances;
+	// bit n is set when the instance with id n has new data
+	static volatile uint32_t ready_instances;
 
-	static std::array<MPU6050*, 2> instances;
-	static std::array<void (*)(uint gpio, uint32_t event), 2> callbacks;
+	static bool register_instance(MPU6050* mpu);
+	static void unregister_instance(MPU6050* mpu);
+	static size_t instance_count();
+	static uint32_t take_ready_instances();
 
 	MPU6050(
 		i2c_inst_t* i2c,
@@ -77,33 +133,132 @@ public:
 	MPU6050& operator=(const MPU6050&)=delete;
 	MPU6050& operator=(const MPU6050&&)=delete;
 
-	void reset_device() const;
+	// false when the constructor could not register, configure or
+	// calibrate the device, check it before using the instance
+	bool ok() const;
+
+	bool reset_device();
 	void callibrate();
-	void fast_calibrate();
+	bool fast_calibrate();
 
-	void start();
+	bool start();
+	// writes SMPLRT_DIV..ACCEL_CONFIG in one burst and verifies them by reading back
+	bool apply_configuration() const;
+	bool wait_for_data_ready(uint32_t timeout_us) const;
 
-	void init_pin_interrupt() const;
+	void init_pin_interrupt();
 	void deinit_pin_interrupt() const;
 
+	uint32_t instance_id() const;
+	uint32_t sample_rate() const;
+
 	uint8_t read_byte(Register reg) const;
+	bool read_bytes(Register reg, uint8_t* buffer, size_t length) const;
 	void write_byte(Register reg, uint8_t value) const;
+	// writes count consecutive registers starting at first_reg in one transaction
+	bool write_bytes(Register first_reg, const uint8_t* values, size_t count) const;
+
+	// Register shadow
+	//   Writes go through to the device and the shadow. update_bits() only
+	//   changes the shadow, flush_registers() writes every dirty register
+	//   and flush_register() just the one. The setters and fifo helpers
+	//   flush only the registers they change, pending changes elsewhere
+	//   are left for the caller's flush.
+	uint8_t cached_register(Register reg) const;
+	void update_bits(Register reg, uint8_t mask, uint8_t value);
+	bool flush_register(Register reg);
+	bool flush_registers();
+	bool resync_registers();
+	bool verify_registers() const;
+	bool set_sleep_enabled(bool sleep);
+	bool set_clock_source(PWR_MGMT_1 clock_source);
+	bool set_interrupt_enabled(INTERRUPT_ENABLE interrupt, bool enabled);
 
 	bool available() const;
 	bool read_data_from_device();
 
+	// FIFO mode
+	//   Samples are queued on the device at the configured sample rate and
+	//   drained in bursts with read_fifo(). The buffer passed to read_fifo()
+	//   must hold max_frames * fifo_frame_size() bytes.
+	//   Only the fifo bits of USER_CTRL, FIFO_EN and INT_ENABLE are changed,
+	//   through the register shadow.
+	bool enable_fifo(bool include_temperature);
+	bool disable_fifo();
+	bool reset_fifo();
+	bool fifo_enabled() const;
+	size_t fifo_frame_size() const;
+	uint16_t read_fifo_count() const;
+	size_t read_fifo(uint8_t* buffer, size_t max_frames);
+	uint32_t fifo_overflow_count() const;
+	Values decode_fifo_frame(const uint8_t* frame) const;
+	RawFrameView fifo_frames(const uint8_t* buffer, size_t frame_count) const;
+
+	// Asynchronous mode
+	//   Each data ready interrupt starts a DMA paced read of INT_STATUS and
+	//   the sample block into one half of a double buffer. The callback, if
+	//   any, runs in the DMA interrupt once the transfer has finished.
+	//   One device per i2c instance can be asynchronous, enable_async()
+	//   fails for a second. Blocking reads and writes must not be issued on
+	//   the same i2c instance while a transfer is in flight.
+	bool enable_async(AsyncReadCallback callback);
+	void disable_async();
+	bool async_enabled() const;
+	bool start_async_read();
+	bool async_read_complete() const;
+	uint8_t consume_async_read();
+	uint32_t async_error_count() const;
+	// data ready interrupt to the end of the transfer for the newest sample
+	uint32_t last_async_read_us() const;
+
+	// Sample ring
+	//   Every sample read is also queued with its time, so nothing is lost
+	//   while the consumer is busy. Asynchronous reads and
+	//   read_data_from_device() after available() use the time of the data
+	//   ready interrupt, other blocking reads the time of the read, and
+	//   fifo frames are spaced a sample period apart back from the read.
+	//   The reading context is the one producer, one consumer drains it,
+	//   the timestamps give the true dt between samples. Full rings drop
+	//   new samples and count an overrun, callers that never drain it can
+	//   ignore that count.
+	bool pop_sample(RawSample* sample);
+	template<typename F>
+	size_t drain_samples(F&& f) {
+		return _sample_ring.drain(f);
+	}
+	size_t samples_pending() const;
+	uint32_t sample_overrun_count() const;
+	// data ready edges that arrived before the previous sample was taken
+	uint32_t missed_interrupt_count() const;
+	static Values decode_sample(const RawSample& sample);
+
 	Values get_raw_values();
 	Values get_offset_values();
 	OffsetAccelScaledGyros get_offset_accel_and_scaled_gyros();
+	OffsetAccelScaledGyros get_offset_accel_and_scaled_gyros(const RawSample& sample) const;
 	ScaledValues get_scaled_values();
 private:
+	// devices in asynchronous mode, they share one DMA_IRQ_0 handler
+	static uint32_t async_instance_count;
+	static bool async_i2c_in_use(const i2c_inst_t* i2c);
+
+	// pulses FIFO_RESET with FIFO_EN cleared
+	bool reset_fifo_buffer();
+
+	void on_async_read_complete();
+	void queue_sample(uint32_t timestamp_us, const uint8_t* frame, bool includes_temperature);
+
+	static Values decode_raw_values(const uint8_t* frame, bool includes_temperature);
+
 	std::array<int16_t, 3> read_accel_factory_trim() const;
 
 	std::array<uint8_t, 6> calc_accel_offset_register_values(const std::array<int16_t, 3> &accel_offsets) const;
 	std::array<uint8_t, 6> calc_gyro_offset_register_values(const std::array<int16_t, 3> &gyro_offsets) const;
 
-	void update_accel_offset_registers(const std::array<uint8_t, 6> &offset_register_values) const;
-	void update_gyro_offset_registers(const std::array<uint8_t, 6> &offset_register_values) const;
+	std::array<uint8_t, 4> configuration_register_values() const;
+
+	bool update_accel_offset_registers(const std::array<uint8_t, 6> &offset_register_values) const;
+	bool update_gyro_offset_registers(const std::array<uint8_t, 6> &offset_register_values) const;
 
 	MPU6050Address _address{MPU6050Address::DEFAULT};
 	i2c_inst_t* _i2c{DEFAULT_I2C_INSTANCE};
@@ -114,17 +269,151 @@ private:
 
 	ACCEL_CONFIG _accel_full_scale_select{DEFAULT_ACCEL_FULL_SCALE_SELECT};
 	float _accel_scale_factor;
+	float _accel_scale_reciprocal;
 	GYRO_CONFIG _gyro_full_scale_select{DEFAULT_GYRO_FULL_SCALE_SELECT};
 	float _gyro_scale_factor;
+	float _gyro_scale_reciprocal;
+
+	// updated by const register writes
+	mutable RegisterShadow _registers;
 
 	std::array<uint8_t, RAW_DATA_SIZE_BYTES> _buffer{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
+	bool _fifo_enabled{false};
+	size_t _fifo_frame_size{FIFO_FRAME_SIZE_BYTES};
+	uint32_t _fifo_overflow_count{0};
+
+	bool _async_enabled{false};
+	AsyncReadCallback _async_callback{nullptr};
+	uint32_t _dma_tx_channel{0};
+	uint32_t _dma_rx_channel{0};
+	// i2c data commands: the register address followed by one read command per byte
+	std::array<uint32_t, ASYNC_READ_SIZE_BYTES + 1> _async_commands{};
+	std::array<std::array<uint8_t, ASYNC_READ_SIZE_BYTES>, 2> _async_buffers{};
+	volatile uint8_t _async_write_index{0};
+	volatile uint8_t _async_read_index{1};
+	volatile bool _async_busy{false};
+	volatile bool _async_complete{false};
+	uint32_t _async_error_count{0};
+	uint32_t _async_timestamp_us{0};
+	volatile uint32_t _async_read_us{0};
+
+	SpscRing<RawSample, SAMPLE_RING_CAPACITY> _sample_ring;
+	volatile uint32_t _missed_interrupt_count{0};
+
 	int16_t _accelerometer_deadzone{DEFAULT_ACCEL_DEADZONE};
 	int16_t _gyroscope_deadzone{DEFAULT_GYRO_DEADZONE};
 
-	uint32_t _instance_id;
+	uint32_t _instance_id{INVALID_INSTANCE_ID};
 	uint8_t _interrupt_pin_number{0};
 	volatile bool _data_available{false};
+	// data ready interrupt of the sample _data_available announces
+	volatile uint32_t _interrupt_timestamp_us{0};
+	bool _ok{false};
+};
+
+/*
+Configuration fixed at compile time for ConfiguredMPU6050.
+	using ImuConfig = StaticMPU6050Config<
+		ACCEL_CONFIG::FS_SELECT_16_G_BIT,
+		GYRO_CONFIG::FS_SELECT_250_DEG_PER_SEC_BIT,
+		DLPF_CONFIG::DLPF_CFG_BANDWIDTH_94_Hz,
+		100>;
+*/
+template<
+	ACCEL_CONFIG accel_fs,
+	GYRO_CONFIG gyro_fs,
+	DLPF_CONFIG dlpf,
+	uint32_t sample_rate,
+	int16_t accel_deadzone = DEFAULT_ACCEL_DEADZONE,
+	int16_t gyro_deadzone = DEFAULT_GYRO_DEADZONE
+>
+struct StaticMPU6050Config {
+	static_assert(valid_sample_rate(dlpf, sample_rate),
+		"the sample rate must evenly divide the gyroscope output rate (8kHz with the DLPF off, 1kHz otherwise) with a divider of at most 256");
+
+	static constexpr ACCEL_CONFIG accel_full_scale_select{accel_fs};
+	static constexpr GYRO_CONFIG gyro_full_scale_select{gyro_fs};
+	static constexpr DLPF_CONFIG dlpf_bandwidth{dlpf};
+	static constexpr uint32_t sample_rate_hz{sample_rate};
+	static constexpr uint8_t smplrt_div{sample_rate_divider(dlpf, sample_rate)};
+
+	static constexpr float accel_scale_reciprocal{1.0F / accelerometer_scale_factor(accel_fs)};
+	static constexpr float gyro_scale_reciprocal{1.0F / gyroscope_scale_factor(gyro_fs)};
+	static constexpr uint8_t accel_q14_shift{accelerometer_q14_shift(accel_fs)};
+	static constexpr int32_t gyro_q16_per_lsb{gyroscope_q16_per_lsb(gyro_fs)};
+
+	static constexpr int16_t accelerometer_deadzone{accel_deadzone};
+	static constexpr int16_t gyroscope_deadzone{gyro_deadzone};
+};
+
+/*
+MPU6050 whose scaling is resolved at compile time. Scaled values are
+produced with constexpr reciprocals, and the fixed point getters avoid
+floating point entirely. Use MPU6050 directly when the configuration has
+to change at runtime.
+*/
+template<typename Config>
+class ConfiguredMPU6050 : public MPU6050 {
+public:
+	using config = Config;
+
+	ConfiguredMPU6050(
+		i2c_inst_t* i2c,
+		MPU6050Address address,
+		uint8_t interrupt_pin_number
+	)
+		: MPU6050(
+			i2c,
+			address,
+			interrupt_pin_number,
+			Config::sample_rate_hz,
+			Config::dlpf_bandwidth,
+			Config::accel_full_scale_select,
+			Config::gyro_full_scale_select)
+	{}
+
+	OffsetAccelScaledGyros get_offset_accel_and_scaled_gyros() {
+		const auto [accel, gyro, temp] = get_raw_values();
+		return {accel, scale_gyro(gyro)};
+	}
+	ScaledValues get_scaled_values() {
+		const auto [accel, gyro, temp] = get_raw_values();
+
+		auto accel_scaled = std::array<float, 3>{0, 0, 0};
+		for (uint32_t i = 0; i < 3; i++) {
+			accel_scaled[i] = static_cast<float>(accel[i]) * Config::accel_scale_reciprocal;
+		}
+		const auto temp_scaled{static_cast<float>(temp) * TEMPERATURE_SCALE_RECIPROCAL + TEMPERATURE_OFFSET};
+		return {accel_scaled, scale_gyro(gyro), temp_scaled};
+	}
+
+	// acceleration in Q14 g, 1 g == 1 << 14
+	std::array<int32_t, 3> get_accel_q14() {
+		const auto [accel, gyro, temp] = get_raw_values();
+		return {
+			static_cast<int32_t>(accel[0]) * (1 << Config::accel_q14_shift),
+			static_cast<int32_t>(accel[1]) * (1 << Config::accel_q14_shift),
+			static_cast<int32_t>(accel[2]) * (1 << Config::accel_q14_shift)
+		};
+	}
+	// angular rate in Q16 degrees per second
+	std::array<int32_t, 3> get_gyro_q16() {
+		const auto [accel, gyro, temp] = get_raw_values();
+		return {
+			gyro[0] * Config::gyro_q16_per_lsb,
+			gyro[1] * Config::gyro_q16_per_lsb,
+			gyro[2] * Config::gyro_q16_per_lsb
+		};
+	}
+private:
+	static std::array<float, 3> scale_gyro(const std::array<int16_t, 3> &gyro) {
+		return {
+			static_cast<float>(gyro[0]) * Config::gyro_scale_reciprocal,
+			static_cast<float>(gyro[1]) * Config::gyro_scale_reciprocal,
+			static_cast<float>(gyro[2]) * Config::gyro_scale_reciprocal
+		};
+	}
 };
 
 #endif
\ No newline at end of file
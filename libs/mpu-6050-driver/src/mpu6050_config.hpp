@@ -14,6 +14,7 @@
 
 #include <cassert>  // assert
 #include <cstdint>  // uint8_t
+#include <cstdlib>  // exit
 
 enum class MPU6050Address {
 	DEFAULT  = 0x68,
@@ -68,6 +69,29 @@ enum class INTERRUPT_ENABLE: uint8_t {
 	I2C_MASTER_INTERRUPT_ENABLE_BIT = 0x08,
 	FIFO_OVERFLOW_ENABLE_BIT        = 0x10
 };
+enum class INTERRUPT_STATUS: uint8_t {
+	DATA_READY_BIT           = 0x01,
+	I2C_MASTER_INTERRUPT_BIT = 0x08,
+	FIFO_OVERFLOW_BIT        = 0x10
+};
+enum class FIFO_ENABLE: uint8_t {
+	TEMP_FIFO_EN_BIT  = 0x80,
+	XG_FIFO_EN_BIT    = 0x40,
+	YG_FIFO_EN_BIT    = 0x20,
+	ZG_FIFO_EN_BIT    = 0x10,
+	ACCEL_FIFO_EN_BIT = 0x08,
+	SLV2_FIFO_EN_BIT  = 0x04,
+	SLV1_FIFO_EN_BIT  = 0x02,
+	SLV0_FIFO_EN_BIT  = 0x01
+};
+enum class USER_CTRL: uint8_t {
+	FIFO_EN_BIT        = 0x40,
+	I2C_MST_EN_BIT     = 0x20,
+	I2C_IF_DIS_BIT     = 0x10,
+	FIFO_RESET_BIT     = 0x04,
+	I2C_MST_RESET_BIT  = 0x02,
+	SIG_COND_RESET_BIT = 0x01
+};
 
 constexpr uint8_t ACCEL_FS_SELECT_POSITION{0x03};
 constexpr uint8_t ACCEL_FS_SELECT_LENGTH{0x02};
@@ -100,6 +124,23 @@ constexpr float accelerometer_scale_factor(ACCEL_CONFIG fs_select_bit) {
 	}
 }
 
+// Shift that brings a raw reading to Q14 g, 1 g == 1 << 14 for every range.
+constexpr uint8_t accelerometer_q14_shift(ACCEL_CONFIG fs_select_bit) {
+	switch (fs_select_bit) {
+		case ACCEL_CONFIG::FS_SELECT_2_G_BIT:
+			return 0;
+		case ACCEL_CONFIG::FS_SELECT_4_G_BIT:
+			return 1;
+		case ACCEL_CONFIG::FS_SELECT_8_G_BIT:
+			return 2;
+		case ACCEL_CONFIG::FS_SELECT_16_G_BIT:
+			return 3;
+		default:
+			assert(false);
+			exit(-1);
+	}
+}
+
 constexpr uint8_t GYRO_FS_SELECT_POSITION{0x03};
 constexpr uint8_t FS_SELECT_LENGTH{0x02};
 
@@ -130,6 +171,12 @@ constexpr float gyroscope_scale_factor(GYRO_CONFIG fs_select_bit) {
 	}
 }
 
+// Multiplier that brings a raw reading to Q16 degrees per second,
+// round(65536 / scale factor). The rounding error is below 0.06%.
+constexpr int32_t gyroscope_q16_per_lsb(GYRO_CONFIG fs_select_bit) {
+	return static_cast<int32_t>(65536.0F / gyroscope_scale_factor(fs_select_bit) + 0.5F);
+}
+
 enum class DLPF_CONFIG: uint8_t {
 	DLPF_CFG_BANDWIDTH_260_Hz = 0x00,
 	DLPF_CFG_BANDWIDTH_184_Hz = 0x01,
@@ -140,6 +187,32 @@ enum class DLPF_CONFIG: uint8_t {
 	DLPF_CFG_BANDWIDTH_5_Hz   = 0x06
 };
 
+// smplrt_div
+//   sample rate = gyroscope_output_rate / (1 + SMPLRT_DIV)
+//   gyroscope_output_rate = 8kHz when DLPF is disabled (DLPF_CFG = 0 or 7)
+//   gyroscope_output_rate = 1KHz when DLPF is enabled
+constexpr uint32_t gyroscope_output_rate(DLPF_CONFIG dlpf) {
+	return dlpf == DLPF_CONFIG::DLPF_CFG_BANDWIDTH_260_Hz ? 8000 : 1000;
+}
+constexpr bool valid_sample_rate(DLPF_CONFIG dlpf, uint32_t sample_rate_hz) {
+	const uint32_t output_rate{gyroscope_output_rate(dlpf)};
+	return sample_rate_hz > 0
+		&& sample_rate_hz <= output_rate
+		&& output_rate % sample_rate_hz == 0
+		&& output_rate / sample_rate_hz - 1 <= UINT8_MAX;
+}
+// Rates that are not reachable are rounded down to the nearest one that is.
+constexpr uint8_t sample_rate_divider(DLPF_CONFIG dlpf, uint32_t sample_rate_hz) {
+	const uint32_t output_rate{gyroscope_output_rate(dlpf)};
+	if (sample_rate_hz == 0 || output_rate / sample_rate_hz > UINT8_MAX + 1) {
+		return UINT8_MAX;
+	}
+	if (sample_rate_hz >= output_rate) {
+		return 0;
+	}
+	return static_cast<uint8_t>((output_rate + sample_rate_hz - 1) / sample_rate_hz - 1);
+}
+
 enum class Register: uint8_t {
 	X_FINE_GAIN        = 0x03,
 	Y_FINE_GAIN        = 0x04,
@@ -198,7 +271,7 @@ enum class Register: uint8_t {
 	ACCEL_XOUT_L       = 0x3C,
 	ACCEL_YOUT_H       = 0x3D,
 	ACCEL_YOUT_L       = 0x3E,
-	ACCEL_ZOUT_H       = 0x4F,
+	ACCEL_ZOUT_H       = 0x3F,
 	ACCEL_ZOUT_L       = 0x40,
 
 	TEMP_OUT_H         = 0x41,
@@ -0,0 +1,170 @@
+// File: number_format.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef NUMBER_FORMAT_HPP
+#define NUMBER_FORMAT_HPP
+
+#include <array>   // array
+#include <cstddef> // size_t
+#include <cstdint> // int32_t, uint32_t, uint64_t
+#include <cstring> // memcpy
+
+#include "fixed_point.hpp"
+
+/*
+Fixed decimal formatting without printf. Writes "-12.34" style text into
+char or wchar_t buffers using integer math only, no float formatting code
+is pulled in and nothing is allocated.
+
+Every function null terminates and returns the length written. When the
+text does not fit, or the value is out of range, the buffer is left empty
+and 0 is returned.
+*/
+
+constexpr uint8_t MAX_FORMAT_DECIMALS{6};
+
+constexpr std::array<uint32_t, MAX_FORMAT_DECIMALS + 1> FORMAT_POWERS_OF_TEN{
+	1, 10, 100, 1000, 10000, 100000, 1000000
+};
+// sign, 10 integer digits, point and decimals
+constexpr size_t MAX_FORMAT_LENGTH{1 + 10 + 1 + MAX_FORMAT_DECIMALS};
+
+template<typename CharT>
+size_t clear_formatted(CharT* buffer, size_t size) {
+	if (size > 0) {
+		buffer[0] = static_cast<CharT>('\0');
+	}
+	return 0;
+}
+
+// Digits are built backwards from the last one.
+template<typename CharT>
+size_t write_formatted(CharT* buffer, size_t size, bool negative, uint32_t integer, uint32_t fraction, uint8_t decimals) {
+	std::array<CharT, MAX_FORMAT_LENGTH> digits{};
+	size_t length{0};
+	for (uint8_t i = 0; i < decimals; i++) {
+		digits[length++] = static_cast<CharT>('0' + fraction % 10);
+		fraction /= 10;
+	}
+	if (decimals > 0) {
+		digits[length++] = static_cast<CharT>('.');
+	}
+	do {
+		digits[length++] = static_cast<CharT>('0' + integer % 10);
+		integer /= 10;
+	} while (integer != 0);
+	if (negative) {
+		digits[length++] = static_cast<CharT>('-');
+	}
+
+	if (length >= size) {
+		return clear_formatted(buffer, size);
+	}
+	for (size_t i = 0; i < length; i++) {
+		buffer[i] = digits[length - 1 - i];
+	}
+	buffer[length] = static_cast<CharT>('\0');
+	return length;
+}
+
+/*
+Rounds value / 2^shift, the scaled fraction, to the nearest integer with
+ties to even. With no decimals the quotient is always 0 and the last digit
+is the integer's, odd_integer says whether that one is odd.
+*/
+constexpr uint32_t round_shifted(uint64_t value, uint32_t shift, bool odd_integer) {
+	if (shift == 0) {
+		return static_cast<uint32_t>(value);
+	}
+	if (shift >= 64) {
+		// value is below 2^44 here, well under half of 2^shift
+		return 0;
+	}
+	const auto quotient{static_cast<uint32_t>(value >> shift)};
+	const uint64_t remainder{value & ((uint64_t{1} << shift) - 1U)};
+	const uint64_t half{uint64_t{1} << (shift - 1)};
+	const bool odd{(quotient & 1U) != 0U || odd_integer};
+	return remainder > half || (remainder == half && odd) ? quotient + 1 : quotient;
+}
+
+template<typename CharT>
+size_t format_integer(CharT* buffer, size_t size, int32_t value) {
+	const bool negative{value < 0};
+	const uint32_t magnitude{negative ? 0U - static_cast<uint32_t>(value) : static_cast<uint32_t>(value)};
+	return write_formatted(buffer, size, negative, magnitude, 0, 0);
+}
+
+/*
+Exact, the float's binary value is rounded half to even like printf's
+"%.*f". Magnitudes of 2^32 and above do not fit.
+
+The value is split into mantissa * 2^exponent, the fraction bits are
+scaled by 10^decimals in 64 bits and shifted back, no float math.
+*/
+template<typename CharT>
+size_t format_decimal(CharT* buffer, size_t size, float value, uint8_t decimals) {
+	constexpr float LIMIT{4294967296.0F};
+	// NaN fails every comparison
+	if (decimals > MAX_FORMAT_DECIMALS || !(value > -LIMIT && value < LIMIT)) {
+		return clear_formatted(buffer, size);
+	}
+	uint32_t bits{0};
+	std::memcpy(&bits, &value, sizeof(bits));
+	const bool negative{(bits >> 31) != 0U};
+	const uint32_t biased_exponent{(bits >> 23) & 0xFFU};
+	const uint32_t mantissa{biased_exponent == 0
+		? bits & 0x7FFFFFU
+		: (bits & 0x7FFFFFU) | 0x800000U};
+	// value = mantissa * 2^(biased_exponent - 150), subnormals use 1 - 150
+	const int32_t exponent{static_cast<int32_t>(biased_exponent == 0 ? 1 : biased_exponent) - 150};
+	const uint32_t scale{FORMAT_POWERS_OF_TEN[decimals]};
+
+	uint32_t integer{0};
+	uint32_t fraction{0};
+	if (exponent >= 0) {
+		integer = mantissa << exponent;
+	} else {
+		const auto shift{static_cast<uint32_t>(-exponent)};
+		integer = shift < 32 ? mantissa >> shift : 0;
+		const uint32_t fraction_bits{shift < 32 ? mantissa & ((1U << shift) - 1U) : mantissa};
+		fraction = round_shifted(static_cast<uint64_t>(fraction_bits) * scale, shift,
+			decimals == 0 && (integer & 1U) != 0U);
+	}
+	if (fraction >= scale) {
+		if (integer == UINT32_MAX) {
+			return clear_formatted(buffer, size);
+		}
+		fraction -= scale;
+		integer++;
+	}
+	// no "-0.00"
+	const bool shown_negative{negative && (integer != 0 || fraction != 0)};
+	return write_formatted(buffer, size, shown_negative, integer, fraction, decimals);
+}
+
+// Exact, the fraction is rounded from the raw bits half to even.
+template<int fraction_bits, typename CharT>
+size_t format_decimal(CharT* buffer, size_t size, Fixed<fraction_bits> value, uint8_t decimals) {
+	if (decimals > MAX_FORMAT_DECIMALS) {
+		return clear_formatted(buffer, size);
+	}
+	const int32_t raw{value.raw()};
+	const bool negative{raw < 0};
+	const uint32_t magnitude{negative ? 0U - static_cast<uint32_t>(raw) : static_cast<uint32_t>(raw)};
+	const uint32_t scale{FORMAT_POWERS_OF_TEN[decimals]};
+	constexpr uint32_t FRACTION_MASK{(1U << fraction_bits) - 1U};
+
+	uint32_t integer{magnitude >> fraction_bits};
+	uint32_t fraction{round_shifted(static_cast<uint64_t>(magnitude & FRACTION_MASK) * scale,
+		fraction_bits, decimals == 0 && (integer & 1U) != 0U)};
+	if (fraction >= scale) {
+		fraction -= scale;
+		integer++;
+	}
+	const bool shown_negative{negative && (integer != 0 || fraction != 0)};
+	return write_formatted(buffer, size, shown_negative, integer, fraction, decimals);
+}
+
+#endif
@@ -0,0 +1,155 @@
+// File: register_shadow.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef REGISTER_SHADOW_HPP
+#define REGISTER_SHADOW_HPP
+
+#include <array>   // array
+#include <cstddef> // size_t
+#include <cstdint> // uint8_t
+
+#include "mpu6050_config.hpp"
+
+// one slot per register address, 0x00 through WHO_AM_I
+constexpr size_t REGISTER_COUNT{static_cast<size_t>(Register::WHO_AM_I) + 1};
+
+struct RegisterRange {
+	Register first;
+	Register last;
+
+	constexpr size_t size() const {
+		return static_cast<size_t>(last) - static_cast<size_t>(first) + 1;
+	}
+};
+
+// Configuration registers that hold their value once written. Strobe only
+// registers (SIGNAL_PATH_RESET), data and status registers are left out.
+constexpr std::array<RegisterRange, 7> WRITABLE_REGISTER_RANGES = {
+	RegisterRange{Register::XA_OFFS_USRH, Register::ZA_OFFS_USRL},
+	RegisterRange{Register::SELF_TEXT_X, Register::SELF_TEXT_A},
+	RegisterRange{Register::XG_OFFS_USRH, Register::ACCEL_CONFIG},
+	RegisterRange{Register::FIFO_EN, Register::I2C_SLV4_CTRL},
+	RegisterRange{Register::INT_PIN_CFG, Register::INT_ENABLE},
+	RegisterRange{Register::I2C_SLV0_DO, Register::I2C_MST_DELAY_CTRL},
+	RegisterRange{Register::USER_CTRL, Register::PWR_MGMT_2}
+};
+
+constexpr size_t largest_writable_range() {
+	size_t largest{0};
+	for (const auto& range : WRITABLE_REGISTER_RANGES) {
+		largest = range.size() > largest ? range.size() : largest;
+	}
+	return largest;
+}
+constexpr size_t MAX_WRITABLE_RANGE_SIZE{largest_writable_range()};
+
+constexpr bool is_writable_register(Register reg) {
+	for (const auto& range : WRITABLE_REGISTER_RANGES) {
+		if (reg >= range.first && reg <= range.last) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Bits that trigger an action and clear themselves, they never read back as set.
+constexpr uint8_t self_clearing_bits(Register reg) {
+	switch (reg) {
+		case Register::PWR_MGMT_1:
+			return static_cast<uint8_t>(PWR_MGMT_1::RESET_BIT);
+		case Register::USER_CTRL:
+			return static_cast<uint8_t>(USER_CTRL::FIFO_RESET_BIT)
+				| static_cast<uint8_t>(USER_CTRL::I2C_MST_RESET_BIT)
+				| static_cast<uint8_t>(USER_CTRL::SIG_COND_RESET_BIT);
+		default:
+			return 0;
+	}
+}
+
+/*
+RAM copy of the writable register file.
+	store() records a value known to be on the device.
+	set() and update_bits() change the copy and mark the register dirty
+	until it is written out and store()d.
+*/
+class RegisterShadow {
+public:
+	uint8_t get(Register reg) const {
+		return _values[index(reg)];
+	}
+	void store(Register reg, uint8_t value) {
+		if (!is_writable_register(reg)) {
+			return;
+		}
+		_values[index(reg)] = value & ~self_clearing_bits(reg);
+		clear_dirty(reg);
+	}
+	void set(Register reg, uint8_t value) {
+		if (!is_writable_register(reg)) {
+			return;
+		}
+		if (_values[index(reg)] != value) {
+			_values[index(reg)] = value;
+			mark_dirty(reg);
+		}
+	}
+	void update_bits(Register reg, uint8_t mask, uint8_t value) {
+		set(reg, (get(reg) & ~mask) | (value & mask));
+	}
+
+	bool is_dirty(Register reg) const {
+		const size_t i{index(reg)};
+		return (_dirty[i / 32] & (1U << (i % 32))) != 0U;
+	}
+	bool any_dirty() const {
+		for (const auto word : _dirty) {
+			if (word != 0U) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Calls f(first_register, count) for every run of consecutive dirty
+	// registers, splitting runs longer than max_run.
+	template<typename F>
+	void for_each_dirty_run(size_t max_run, F&& f) const {
+		size_t i{0};
+		while (i < REGISTER_COUNT) {
+			if (!is_dirty(static_cast<Register>(i))) {
+				i++;
+				continue;
+			}
+			const size_t first{i};
+			while (i < REGISTER_COUNT
+				&& i - first < max_run
+				&& is_dirty(static_cast<Register>(i)))
+			{
+				i++;
+			}
+			f(static_cast<Register>(first), i - first);
+		}
+	}
+	const uint8_t* values_from(Register reg) const {
+		return &_values[index(reg)];
+	}
+private:
+	static constexpr size_t index(Register reg) {
+		return static_cast<size_t>(reg);
+	}
+	void mark_dirty(Register reg) {
+		const size_t i{index(reg)};
+		_dirty[i / 32] |= 1U << (i % 32);
+	}
+	void clear_dirty(Register reg) {
+		const size_t i{index(reg)};
+		_dirty[i / 32] &= ~(1U << (i % 32));
+	}
+
+	std::array<uint8_t, REGISTER_COUNT> _values{};
+	std::array<uint32_t, (REGISTER_COUNT + 31) / 32> _dirty{};
+};
+
+#endif
@@ -0,0 +1,110 @@
+// File: sample_batch.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef SAMPLE_BATCH_HPP
+#define SAMPLE_BATCH_HPP
+
+#include <algorithm> // min
+#include <array>     // array
+#include <cstddef>   // size_t
+#include <cstdint>   // int16_t, uint8_t
+
+constexpr size_t RAW_FRAME_SIZE_BYTES{14};
+constexpr size_t RAW_FRAME_WITHOUT_TEMP_SIZE_BYTES{12};
+
+inline int16_t read_big_endian_int16(const uint8_t* bytes) {
+	return static_cast<int16_t>(bytes[0] << 8 | bytes[1]);
+}
+
+/*
+Zero copy view over consecutive raw frames as read from the device.
+	14 byte frames: accel xyz, temp, gyro xyz (sensor registers, fifo with temperature)
+	12 byte frames: accel xyz, gyro xyz (fifo without temperature)
+All values are big endian.
+*/
+class RawFrameView {
+public:
+	RawFrameView(const uint8_t* data, size_t frame_count, bool includes_temperature)
+		: _data{data}
+		, _frame_count{frame_count}
+		, _frame_size{includes_temperature ? RAW_FRAME_SIZE_BYTES : RAW_FRAME_WITHOUT_TEMP_SIZE_BYTES}
+		, _gyro_offset{includes_temperature ? size_t{8} : size_t{6}}
+	{}
+
+	size_t size() const {
+		return _frame_count;
+	}
+	size_t frame_size() const {
+		return _frame_size;
+	}
+	bool includes_temperature() const {
+		return _frame_size == RAW_FRAME_SIZE_BYTES;
+	}
+	const uint8_t* frame(size_t index) const {
+		return _data + index * _frame_size;
+	}
+
+	int16_t accel(size_t index, size_t axis) const {
+		return read_big_endian_int16(frame(index) + 2 * axis);
+	}
+	int16_t gyro(size_t index, size_t axis) const {
+		return read_big_endian_int16(frame(index) + _gyro_offset + 2 * axis);
+	}
+	int16_t temperature(size_t index) const {
+		return includes_temperature() ? read_big_endian_int16(frame(index) + 6) : int16_t{0};
+	}
+private:
+	const uint8_t* _data;
+	size_t _frame_count;
+	size_t _frame_size;
+	size_t _gyro_offset;
+};
+
+// One sample block as read from the device and when its data ready interrupt fired.
+struct RawSample {
+	uint32_t timestamp_us;
+	std::array<uint8_t, RAW_FRAME_SIZE_BYTES> data;
+
+	RawFrameView view() const {
+		return RawFrameView(data.data(), 1, true);
+	}
+};
+
+/*
+Struct of arrays sample storage, accel[0] holds every x axis reading
+contiguously, and so on.
+*/
+template<size_t capacity>
+struct SampleBatch {
+	std::array<std::array<int16_t, capacity>, 3> accel;
+	std::array<std::array<int16_t, capacity>, 3> gyro;
+	std::array<int16_t, capacity> temperature;
+	size_t count{0};
+};
+
+// Decodes up to capacity frames in one pass, returns the number decoded.
+template<size_t capacity>
+size_t decode_frames(const RawFrameView& frames, SampleBatch<capacity>* batch) {
+	const size_t count{std::min(frames.size(), capacity)};
+	const size_t frame_size{frames.frame_size()};
+	const bool includes_temperature{frames.includes_temperature()};
+	const size_t gyro_offset{includes_temperature ? size_t{8} : size_t{6}};
+	const uint8_t* frame{frames.frame(0)};
+
+	for (size_t i = 0; i < count; i++, frame += frame_size) {
+		batch->accel[0][i] = read_big_endian_int16(frame);
+		batch->accel[1][i] = read_big_endian_int16(frame + 2);
+		batch->accel[2][i] = read_big_endian_int16(frame + 4);
+		batch->temperature[i] = includes_temperature ? read_big_endian_int16(frame + 6) : int16_t{0};
+		batch->gyro[0][i] = read_big_endian_int16(frame + gyro_offset);
+		batch->gyro[1][i] = read_big_endian_int16(frame + gyro_offset + 2);
+		batch->gyro[2][i] = read_big_endian_int16(frame + gyro_offset + 4);
+	}
+
+	batch->count = count;
+	return count;
+}
+
+#endif
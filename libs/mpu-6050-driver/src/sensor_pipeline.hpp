@@ -0,0 +1,223 @@
+// File: sensor_pipeline.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef SENSOR_PIPELINE_HPP
+#define SENSOR_PIPELINE_HPP
+
+#include <cstdint> // uint32_t, uintptr_t
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/util/queue.h"
+
+#include "mpu6050.hpp"
+#include "median_filter.hpp"
+#include "seqlock.hpp"
+
+constexpr uint32_t PIPELINE_RESULT_QUEUE_LENGTH{8};
+constexpr size_t DEFAULT_PIPELINE_MEDIAN_SIZE{9};
+
+struct PipelineResult {
+	float pitch;
+	float roll;
+	// when the data ready interrupt for the sample fired
+	uint32_t sample_timestamp_us;
+	uint32_t sequence;
+};
+
+struct PipelineStats {
+	uint32_t samples_processed;
+	// lost before filtering, ring overruns and missed data ready edges
+	uint32_t samples_dropped;
+	// filtered but pushed out of the full result queue
+	uint32_t results_dropped;
+	// data ready interrupt to poll() on core0
+	uint32_t last_latency_us;
+	uint32_t max_latency_us;
+	uint32_t average_latency_us;
+	// per sample stage times on core1
+	uint32_t read_us;
+	uint32_t filter_us;
+};
+
+/*
+Runs acquisition and filtering on core1 and publishes the angles to core0.
+
+start() moves the device's data ready interrupt to core1 and switches it
+to asynchronous mode, so samples arrive through the sample ring no matter
+what core0 is doing. Every sample is median filtered and fed to the
+filter, the result goes into a queue that core0 empties with poll().
+When core0 falls behind, the oldest result is dropped. Readers that only
+need the newest result, from either core, can use latest() instead.
+
+Each update is given the time since the previous sample, from their data
+ready timestamps, so dropped or late samples do not skew the integration.
+
+Owns core1 until stop(). Filter needs update(accel, gyro), set_dt(seconds)
+and get_filtered_angles() like ComplementaryFilter.
+*/
+template<typename Filter, size_t median_size = DEFAULT_PIPELINE_MEDIAN_SIZE>
+class SensorPipeline {
+public:
+	SensorPipeline(MPU6050* mpu, Filter* filter)
+		: _mpu{mpu}
+		, _filter{filter}
+	{
+		queue_init(&_results, sizeof(PipelineResult), PIPELINE_RESULT_QUEUE_LENGTH);
+	}
+	~SensorPipeline() {
+		stop();
+		queue_free(&_results);
+	}
+
+	SensorPipeline(const SensorPipeline&)=delete;
+	SensorPipeline(const SensorPipeline&&)=delete;
+	SensorPipeline& operator=(const SensorPipeline&)=delete;
+	SensorPipeline& operator=(const SensorPipeline&&)=delete;
+
+	// Call from core0, blocks until core1 has taken over the device. False
+	// when core1 could not start asynchronous reads, core0 keeps the device.
+	bool start() {
+		if (_running) {
+			return true;
+		}
+		// interrupts are per core, core1 installs its own
+		_mpu->deinit_pin_interrupt();
+		_has_previous_sample = false;
+		multicore_launch_core1(core1_entry);
+		multicore_fifo_push_blocking(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(this)));
+		_running = multicore_fifo_pop_blocking() != 0U;
+		if (!_running) {
+			multicore_reset_core1();
+			_mpu->init_pin_interrupt();
+		}
+		return _running;
+	}
+	// Call from core0, blocks until core1 has stopped asynchronous reads and
+	// released the interrupt pin, then hands the device back to core0.
+	void stop() {
+		if (!_running) {
+			return;
+		}
+		_stop_requested = true;
+		multicore_fifo_pop_blocking();
+		multicore_reset_core1();
+		_mpu->init_pin_interrupt();
+		_stop_requested = false;
+		_running = false;
+	}
+	bool running() const {
+		return _running;
+	}
+	const Seqlock<PipelineResult>& latest() const {
+		return _latest;
+	}
+
+	// Core0, takes the newest result, returns false if nothing new arrived.
+	bool poll(PipelineResult* result) {
+		bool received{false};
+		while (queue_try_remove(&_results, result)) {
+			received = true;
+		}
+		if (received) {
+			const uint32_t latency{time_us_32() - result->sample_timestamp_us};
+			_last_latency_us = latency;
+			_max_latency_us = latency > _max_latency_us ? latency : _max_latency_us;
+			_total_latency_us += latency;
+			_latency_count++;
+		}
+		return received;
+	}
+	PipelineStats stats() const {
+		return PipelineStats {
+			_samples_processed,
+			_mpu->sample_overrun_count() + _mpu->missed_interrupt_count(),
+			_results_dropped,
+			_last_latency_us,
+			_max_latency_us,
+			_latency_count == 0 ? 0 : static_cast<uint32_t>(_total_latency_us / _latency_count),
+			_mpu->last_async_read_us(),
+			_filter_us
+		};
+	}
+private:
+	static void core1_entry() {
+		auto* pipeline{reinterpret_cast<SensorPipeline*>(static_cast<uintptr_t>(multicore_fifo_pop_blocking()))};
+		pipeline->run();
+	}
+	void run() {
+		// blocking register writes first, nothing may share the bus once reads are asynchronous
+		_mpu->init_pin_interrupt();
+		const bool started{_mpu->enable_async(nullptr)};
+		if (!started) {
+			_mpu->deinit_pin_interrupt();
+		}
+		multicore_fifo_push_blocking(started ? 1U : 0U);
+		if (!started) {
+			return;
+		}
+		while (!_stop_requested) {
+			_mpu->drain_samples([this](const RawSample& sample) {
+				process(sample);
+			});
+			tight_loop_contents();
+		}
+		// the dma irq and the pin irq belong to this core, shut them down before the reset
+		_mpu->disable_async();
+		_mpu->deinit_pin_interrupt();
+		multicore_fifo_push_blocking(1U);
+	}
+	void process(const RawSample& sample) {
+		const uint32_t start{time_us_32()};
+		const auto [accel, gyro] = _mpu->get_offset_accel_and_scaled_gyros(sample);
+		_median.update(accel);
+		// the first sample has nothing before it, assume the configured rate
+		const uint32_t dt_us{_has_previous_sample
+			? sample.timestamp_us - _previous_timestamp_us
+			: 1000000U / _mpu->sample_rate()};
+		_previous_timestamp_us = sample.timestamp_us;
+		_has_previous_sample = true;
+		_filter->set_dt(static_cast<float>(dt_us) * 1.0e-6F);
+		_filter->update(_median.get_median(), gyro);
+		const auto [pitch, roll] = _filter->get_filtered_angles();
+		_filter_us = time_us_32() - start;
+
+		const PipelineResult result{pitch, roll, sample.timestamp_us, _sequence};
+		_sequence++;
+		_latest.store(result);
+		if (!queue_try_add(&_results, &result)) {
+			PipelineResult oldest{};
+			queue_try_remove(&_results, &oldest);
+			queue_try_add(&_results, &result);
+			_results_dropped = _results_dropped + 1;
+		}
+		_samples_processed = _samples_processed + 1;
+	}
+
+	MPU6050* _mpu;
+	Filter* _filter;
+	bool _running{false};
+	volatile bool _stop_requested{false};
+
+	// core1
+	MedianFilter3<median_size> _median;
+	uint32_t _previous_timestamp_us{0};
+	bool _has_previous_sample{false};
+	uint32_t _sequence{0};
+	volatile uint32_t _samples_processed{0};
+	volatile uint32_t _results_dropped{0};
+	volatile uint32_t _filter_us{0};
+
+	queue_t _results{};
+	Seqlock<PipelineResult> _latest;
+
+	// core0
+	uint32_t _last_latency_us{0};
+	uint32_t _max_latency_us{0};
+	uint64_t _total_latency_us{0};
+	uint32_t _latency_count{0};
+};
+
+#endif
@@ -0,0 +1,85 @@
+// File: seqlock.hpp
+// Author: Jacob Guenther
+// Date Created: 17 October 2026
+// License: AGPLv3
+
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include <array>       // array
+#include <atomic>      // atomic, atomic_thread_fence
+#include <cstdint>     // uint32_t
+#include <cstring>     // memcpy
+#include <type_traits> // is_trivially_copyable
+
+/*
+Latest value snapshot for one writer and any number of readers on either
+core. The writer never waits. Readers retry if a store ran while they
+copied, no interrupts are disabled and no spinlock is taken.
+
+The sequence is odd while a store is in progress. A reader that interrupts
+the writer on the same core would spin forever in load(), use try_load()
+there instead.
+*/
+template<typename T>
+class Seqlock {
+public:
+	Seqlock() {
+		static_assert(std::is_trivially_copyable_v<T>, "snapshots are copied word by word");
+	}
+	~Seqlock()=default;
+
+	Seqlock(const Seqlock&)=delete;
+	Seqlock(const Seqlock&&)=delete;
+	Seqlock& operator=(const Seqlock&)=delete;
+	Seqlock& operator=(const Seqlock&&)=delete;
+
+	// writer
+	void store(const T &value) {
+		std::array<uint32_t, WORD_COUNT> words{};
+		std::memcpy(words.data(), &value, sizeof(T));
+
+		const uint32_t sequence{_sequence.load(std::memory_order_relaxed)};
+		_sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (size_t i = 0; i < WORD_COUNT; i++) {
+			_words[i].store(words[i], std::memory_order_relaxed);
+		}
+		_sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	// readers
+	T load() const {
+		T value{};
+		while (!try_load(&value)) {}
+		return value;
+	}
+	// One attempt, false if a store was in progress.
+	bool try_load(T* value) const {
+		const uint32_t before{_sequence.load(std::memory_order_acquire)};
+		if ((before & 1U) != 0U) {
+			return false;
+		}
+		std::array<uint32_t, WORD_COUNT> words{};
+		for (size_t i = 0; i < WORD_COUNT; i++) {
+			words[i] = _words[i].load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (_sequence.load(std::memory_order_relaxed) != before) {
+			return false;
+		}
+		std::memcpy(value, words.data(), sizeof(T));
+		return true;
+	}
+	// Number of completed stores, compare to see if anything changed.
+	uint32_t version() const {
+		return _sequence.load(std::memory_order_acquire) / 2;
+	}
+private:
+	static constexpr size_t WORD_COUNT{(sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t)};
+
+	std::atomic<uint32_t> _sequence{0};
+	std::array<std::atomic<uint32_t>, WORD_COUNT> _words{};
+};
+
+#endif